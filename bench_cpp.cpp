@@ -0,0 +1,213 @@
+// bench_cpp.cpp
+//
+// Compares the C++ wrapper (bip353.hpp) against the raw C calls it wraps.
+// Lookups go to the library's local DNS server (built with the `testing`
+// feature), so both sides resolve real, validated answers without network
+// access: blocking resolution with and without the cache, asynchronous
+// resolution, cache probes and address parsing. Every successful result is
+// read through its accessors and freed. Build and run with `make bench-cpp`.
+//
+// usage: bench_cpp [iterations] [latency-us]
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "bip353.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static const char* const kAddress = "user1@example.com";
+static const char* const kUnknownAddress = "user2@example.com";
+
+template <typename F>
+static double ns_per_op(int iterations, F&& op) {
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        op();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+    return elapsed.count() / iterations;
+}
+
+static void report(const char* name, double raw_ns, double wrapped_ns) {
+    std::printf("%-22s raw C %9.1f ns/op   C++ %9.1f ns/op   overhead %+6.1f%%\n",
+                name, raw_ns, wrapped_ns, (wrapped_ns - raw_ns) / raw_ns * 100.0);
+}
+
+// Read a raw result the way a caller would; returns whether it succeeded
+static bool consume(const Bip353Result* result) {
+    if (!result || !result->success) {
+        return false;
+    }
+    volatile size_t length = std::strlen(result->uri) + std::strlen(result->payment_type);
+    (void)length;
+    return true;
+}
+
+static bool consume(const bip353::Result& result) {
+    if (!result) {
+        return false;
+    }
+    volatile size_t length = result.uri().size() + result.payment_type().size();
+    (void)length;
+    return true;
+}
+
+// Completion counter for a window of raw asynchronous resolutions
+struct Window {
+    std::mutex mutex;
+    std::condition_variable done;
+    int pending = 0;
+    std::atomic<int> failed{0};
+};
+
+static void raw_complete(Bip353Result* result, void* user_data) {
+    auto* window = static_cast<Window*>(user_data);
+    if (!consume(result)) {
+        window->failed++;
+    }
+    bip353_result_free(result);
+
+    std::lock_guard<std::mutex> lock(window->mutex);
+    if (--window->pending == 0) {
+        window->done.notify_one();
+    }
+}
+
+// Keep `window` raw C resolutions in flight; returns ns per resolution
+static double raw_async(ResolverPtr* resolver, int batches, int window_size, int& failed) {
+    Window window;
+    auto start = Clock::now();
+    for (int b = 0; b < batches; b++) {
+        window.pending = window_size;
+        for (int i = 0; i < window_size; i++) {
+            if (!bip353_resolve_address_async(resolver, kAddress, 0, nullptr, &raw_complete, &window)) {
+                std::fprintf(stderr, "bip353_resolve_address_async failed\n");
+                std::exit(1);
+            }
+        }
+        std::unique_lock<std::mutex> lock(window.mutex);
+        window.done.wait(lock, [&] { return window.pending == 0; });
+    }
+    failed += window.failed;
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (batches * window_size);
+}
+
+// Keep `window` C++ futures in flight; returns ns per resolution
+static double cpp_async(const bip353::Resolver& resolver, int batches, int window_size, int& failed) {
+    std::vector<std::future<bip353::Result>> pending;
+    pending.reserve(window_size);
+    auto start = Clock::now();
+    for (int b = 0; b < batches; b++) {
+        for (int i = 0; i < window_size; i++) {
+            pending.push_back(resolver.resolve_async(kAddress));
+        }
+        for (auto& future : pending) {
+            if (!consume(future.get())) {
+                failed++;
+            }
+        }
+        pending.clear();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (batches * window_size);
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+    uint64_t latency_us = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+    int failed = 0;
+
+    // Serves kAddress but not kUnknownAddress
+    Bip353TestServer* server = bip353_test_server_start(2, latency_us);
+    if (!server) {
+        std::fprintf(stderr, "failed to start the local DNS server\n");
+        return 1;
+    }
+
+    {
+        bip353::Config config;
+        config.cache_ttl_secs = 3600;
+        bip353::Resolver uncached = bip353::Resolver::local(server, config);
+        config.enable_cache = 1;
+        bip353::Resolver cached = bip353::Resolver::local(server, config);
+
+        // Warm up the runtime and the cache so neither is attributed to one side
+        if (!consume(uncached.resolve(kAddress)) || !consume(cached.resolve(kAddress))) {
+            std::fprintf(stderr, "warm-up resolution of %s failed\n", kAddress);
+            return 1;
+        }
+
+        double raw_uncached = ns_per_op(iterations, [&] {
+            Bip353Result* result = bip353_resolve_address(uncached.get(), kAddress);
+            failed += !consume(result);
+            bip353_result_free(result);
+        });
+        double cpp_uncached = ns_per_op(iterations, [&] {
+            failed += !consume(uncached.resolve(kAddress));
+        });
+        report("resolve (uncached)", raw_uncached, cpp_uncached);
+
+        double raw_cached = ns_per_op(iterations * 50, [&] {
+            Bip353Result* result = bip353_resolve_address(cached.get(), kAddress);
+            failed += !consume(result);
+            bip353_result_free(result);
+        });
+        double cpp_cached = ns_per_op(iterations * 50, [&] {
+            failed += !consume(cached.resolve(kAddress));
+        });
+        report("resolve (cached)", raw_cached, cpp_cached);
+
+        const int window = 64;
+        int batches = iterations / window > 0 ? iterations / window : 1;
+        double raw_window = raw_async(uncached.get(), batches, window, failed);
+        double cpp_window = cpp_async(uncached, batches, window, failed);
+        report("resolve_async (x64)", raw_window, cpp_window);
+
+        double raw_hit = ns_per_op(iterations * 50, [&] {
+            Bip353Result* result = bip353_try_resolve_cached(cached.get(), kAddress, 0);
+            failed += !consume(result);
+            bip353_result_free(result);
+        });
+        double cpp_hit = ns_per_op(iterations * 50, [&] {
+            failed += !consume(cached.try_cached(kAddress));
+        });
+        report("cache probe (hit)", raw_hit, cpp_hit);
+
+        double raw_miss = ns_per_op(iterations * 50, [&] {
+            bip353_result_free(bip353_try_resolve_cached(cached.get(), kUnknownAddress, 0));
+        });
+        double cpp_miss = ns_per_op(iterations * 50, [&] {
+            volatile bool hit = !cached.try_cached(kUnknownAddress).empty();
+            (void)hit;
+        });
+        report("cache probe (miss)", raw_miss, cpp_miss);
+
+        double raw_parse = ns_per_op(iterations * 50, [&] {
+            char* user = nullptr;
+            char* domain = nullptr;
+            if (bip353_parse_address(kAddress, &user, &domain)) {
+                bip353_string_free(user);
+                bip353_string_free(domain);
+            }
+        });
+        double cpp_parse = ns_per_op(iterations * 50, [&] {
+            volatile bool parsed = bip353::parse_address(kAddress).has_value();
+            (void)parsed;
+        });
+        report("parse_address", raw_parse, cpp_parse);
+    }
+
+    bip353_test_server_free(server);
+
+    if (failed > 0) {
+        std::fprintf(stderr, "%d resolutions failed\n", failed);
+        return 1;
+    }
+    return 0;
+}
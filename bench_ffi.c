@@ -0,0 +1,346 @@
+// bench_ffi.c
+//
+// FFI benchmark harness for libbip353. Build and run with `make bench`.
+//
+// Measures runtime startup, resolver create/free, address parsing, cache
+// probes and cached/uncached resolution latency at 1..N threads sharing one
+// ResolverPtr. Human-readable output goes to stderr; one JSON object per
+// measurement goes to stdout for regression tracking.
+//
+// Without --dns, lookups go to the library's local DNS server (built with the
+// `testing` feature), which serves signed records for user0@example.com to
+// user999999@example.com after --latency-us. Every resolution is validated,
+// so uncached, cached and cache-probe hits all measure real answers without
+// network access. --dns points the resolvers at another server instead.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bip353.h"
+
+typedef struct Options {
+    unsigned workers;
+    int max_threads;
+    int iterations;
+    const char* dns;
+    const char* address;
+    long latency_us;
+} Options;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---------------------------------------------------------------------------
+// Latency histogram: log2 buckets with 8 linear sub-buckets (~12% precision)
+// ---------------------------------------------------------------------------
+
+#define HIST_BUCKETS 512
+
+typedef struct Histogram {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} Histogram;
+
+static int hist_bucket(uint64_t v) {
+    if (v < 8) {
+        return (int)v;
+    }
+    int msb = 63 - __builtin_clzll(v);
+    return (msb - 2) * 8 + (int)((v >> (msb - 3)) & 7);
+}
+
+static uint64_t hist_bucket_upper(int idx) {
+    if (idx < 8) {
+        return (uint64_t)idx;
+    }
+    int msb = idx / 8 + 2;
+    uint64_t sub = (uint64_t)(idx % 8);
+    return ((9 + sub) << (msb - 3)) - 1;
+}
+
+static void hist_record(Histogram* h, uint64_t ns) {
+    h->counts[hist_bucket(ns)]++;
+    h->total++;
+    h->sum_ns += ns;
+    if (ns > h->max_ns) {
+        h->max_ns = ns;
+    }
+}
+
+static void hist_merge(Histogram* into, const Histogram* from) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+    into->sum_ns += from->sum_ns;
+    if (from->max_ns > into->max_ns) {
+        into->max_ns = from->max_ns;
+    }
+}
+
+static uint64_t hist_percentile(const Histogram* h, double p) {
+    uint64_t rank = (uint64_t)(p * (double)h->total);
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen > rank) {
+            uint64_t upper = hist_bucket_upper(i);
+            return upper < h->max_ns ? upper : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+static void report(const char* bench, int threads, const Histogram* h, uint64_t ok, uint64_t wall_ns) {
+    double ops_per_sec = wall_ns ? (double)h->total * 1e9 / (double)wall_ns : 0.0;
+    double mean = h->total ? (double)h->sum_ns / (double)h->total : 0.0;
+
+    fprintf(stderr, "%-18s threads=%-3d ops=%-8llu ok=%-8llu %12.0f ops/s  mean %10.0f ns  p50 %9llu  p99 %9llu  p99.9 %9llu\n",
+            bench, threads, (unsigned long long)h->total, (unsigned long long)ok, ops_per_sec, mean,
+            (unsigned long long)hist_percentile(h, 0.50), (unsigned long long)hist_percentile(h, 0.99),
+            (unsigned long long)hist_percentile(h, 0.999));
+
+    printf("{\"bench\":\"%s\",\"threads\":%d,\"ops\":%llu,\"ok\":%llu,\"ops_per_sec\":%.1f,\"mean_ns\":%.1f,"
+           "\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}\n",
+           bench, threads, (unsigned long long)h->total, (unsigned long long)ok, ops_per_sec, mean,
+           (unsigned long long)hist_percentile(h, 0.50), (unsigned long long)hist_percentile(h, 0.90),
+           (unsigned long long)hist_percentile(h, 0.99), (unsigned long long)hist_percentile(h, 0.999),
+           (unsigned long long)h->max_ns);
+    fflush(stdout);
+}
+
+static void report_value(const char* bench, const char* unit, double value) {
+    fprintf(stderr, "%-18s %12.1f %s\n", bench, value, unit);
+    printf("{\"bench\":\"%s\",\"%s\":%.1f}\n", bench, unit, value);
+    fflush(stdout);
+}
+
+static void report_skipped(const char* bench, const char* reason) {
+    fprintf(stderr, "%-18s skipped: %s\n", bench, reason);
+    printf("{\"bench\":\"%s\",\"skipped\":\"%s\"}\n", bench, reason);
+    fflush(stdout);
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+typedef enum Op {
+    OP_RESOLVE,
+    OP_PROBE,
+} Op;
+
+typedef struct Worker {
+    pthread_t thread;
+    ResolverPtr* resolver;
+    const char* address;
+    Op op;
+    int iterations;
+    Histogram hist;
+    uint64_t ok;
+} Worker;
+
+static void* worker_run(void* arg) {
+    Worker* w = (Worker*)arg;
+    for (int i = 0; i < w->iterations; i++) {
+        uint64_t start = now_ns();
+        Bip353Result* result = w->op == OP_RESOLVE
+            ? bip353_resolve_address(w->resolver, w->address)
+            : bip353_try_resolve_cached(w->resolver, w->address, 0);
+        hist_record(&w->hist, now_ns() - start);
+
+        if (result && result->success) {
+            w->ok++;
+        }
+        bip353_result_free(result);
+    }
+    return NULL;
+}
+
+// Run `op` on `threads` threads sharing one resolver and report the merged histogram
+static void bench_scaling(const char* bench, ResolverPtr* resolver, const char* address, Op op,
+                          int threads, int iterations) {
+    Worker* workers = calloc((size_t)threads, sizeof(Worker));
+    uint64_t start = now_ns();
+    for (int t = 0; t < threads; t++) {
+        workers[t].resolver = resolver;
+        workers[t].address = address;
+        workers[t].op = op;
+        workers[t].iterations = iterations;
+        pthread_create(&workers[t].thread, NULL, worker_run, &workers[t]);
+    }
+
+    Histogram merged;
+    memset(&merged, 0, sizeof(merged));
+    uint64_t ok = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        hist_merge(&merged, &workers[t].hist);
+        ok += workers[t].ok;
+    }
+
+    report(bench, threads, &merged, ok, now_ns() - start);
+    free(workers);
+}
+
+// Runtime startup is paid once per process; resolver creation must stay cheap.
+static int bench_startup(unsigned worker_threads) {
+    uint64_t start = now_ns();
+    if (!bip353_init(worker_threads, "bip353-bench", 0)) {
+        fprintf(stderr, "bip353_init failed\n");
+        return 0;
+    }
+    report_value("runtime_init", "us", (double)(now_ns() - start) / 1e3);
+
+    start = now_ns();
+    ResolverPtr* resolver = bip353_resolver_create();
+    report_value("first_create", "us", (double)(now_ns() - start) / 1e3);
+    bip353_resolver_free(resolver);
+    return 1;
+}
+
+static void bench_create_free(int iterations) {
+    Histogram h;
+    memset(&h, 0, sizeof(h));
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        uint64_t op_start = now_ns();
+        bip353_resolver_free(bip353_resolver_create());
+        hist_record(&h, now_ns() - op_start);
+    }
+    report("create_free", 1, &h, h.total, now_ns() - start);
+}
+
+static void bench_parse(const char* address, int iterations) {
+    Histogram h;
+    memset(&h, 0, sizeof(h));
+    uint64_t ok = 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        char* user = NULL;
+        char* domain = NULL;
+        uint64_t op_start = now_ns();
+        if (bip353_parse_address(address, &user, &domain)) {
+            bip353_string_free(user);
+            bip353_string_free(domain);
+            ok++;
+        }
+        hist_record(&h, now_ns() - op_start);
+    }
+    report("parse", 1, &h, ok, now_ns() - start);
+}
+
+// Resolver over `server`, or over the DNS server at `dns` if there is none
+static ResolverPtr* create_resolver(const Bip353TestServer* server, const char* dns, int enable_cache) {
+    Bip353Config config;
+    bip353_config_init(&config);
+    config.dns_resolver = dns;
+    config.enable_cache = enable_cache;
+    config.cache_ttl_secs = 3600;
+    return server ? bip353_resolver_create_local(server, &config) : bip353_resolver_create_with_config(&config);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--workers N] [--threads N] [--iterations N] [--dns ip:port]\n"
+            "          [--address user@domain] [--latency-us N]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    Options opts = { 2, 8, 2000, NULL, "user1@example.com", 0 };
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(arg, "--workers") == 0) {
+            opts.workers = (unsigned)atoi(value);
+        } else if (strcmp(arg, "--threads") == 0) {
+            opts.max_threads = atoi(value);
+        } else if (strcmp(arg, "--iterations") == 0) {
+            opts.iterations = atoi(value);
+        } else if (strcmp(arg, "--dns") == 0) {
+            opts.dns = value;
+        } else if (strcmp(arg, "--address") == 0) {
+            opts.address = value;
+        } else if (strcmp(arg, "--latency-us") == 0) {
+            opts.latency_us = atol(value);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    Bip353TestServer* server = NULL;
+    if (!opts.dns) {
+        server = bip353_test_server_start(1000000, (uint64_t)opts.latency_us);
+        if (!server) {
+            fprintf(stderr, "failed to start the local DNS server\n");
+            return 1;
+        }
+        fprintf(stderr, "local DNS server (latency %ld us)\n", opts.latency_us);
+    }
+
+    if (!bench_startup(opts.workers)) {
+        return 1;
+    }
+    bench_create_free(opts.iterations * 50);
+    bench_parse(opts.address, opts.iterations * 50);
+
+    ResolverPtr* uncached = create_resolver(server, opts.dns, 0);
+    ResolverPtr* cached = create_resolver(server, opts.dns, 1);
+    if (!uncached || !cached) {
+        fprintf(stderr, "failed to create resolvers for %s\n", opts.dns ? opts.dns : "the local DNS server");
+        return 1;
+    }
+
+    for (int threads = 1; threads <= opts.max_threads; threads *= 2) {
+        bench_scaling("resolve_uncached", uncached, opts.address, OP_RESOLVE, threads, opts.iterations);
+    }
+
+    // Cache probes never touch the network, hit or miss. Misses first, while
+    // the cache is still empty; probes do not schedule fills.
+    for (int threads = 1; threads <= opts.max_threads; threads *= 2) {
+        bench_scaling("cache_probe_miss", cached, opts.address, OP_PROBE, threads, opts.iterations * 50);
+    }
+
+    Bip353Result* warmup = bip353_resolve_address(cached, opts.address);
+    int warm = warmup && warmup->success;
+    bip353_result_free(warmup);
+    if (warm) {
+        for (int threads = 1; threads <= opts.max_threads; threads *= 2) {
+            bench_scaling("cache_probe_hit", cached, opts.address, OP_PROBE, threads, opts.iterations * 50);
+        }
+        for (int threads = 1; threads <= opts.max_threads; threads *= 2) {
+            bench_scaling("resolve_cached", cached, opts.address, OP_RESOLVE, threads, opts.iterations * 50);
+        }
+    } else {
+        report_skipped("cache_probe_hit", "warm-up resolution failed");
+        report_skipped("resolve_cached", "warm-up resolution failed");
+    }
+
+    bip353_resolver_free(uncached);
+    bip353_resolver_free(cached);
+    bip353_test_server_free(server);
+
+    uint64_t start = now_ns();
+    bip353_shutdown(0);
+    report_value("runtime_shutdown", "us", (double)(now_ns() - start) / 1e3);
+    return 0;
+}
@@ -0,0 +1,125 @@
+"""
+BIP-353 Python Bindings Benchmark
+
+Measures resolution throughput from Python against the library's local DNS
+server (bip353.LocalDnsServer, from the `testing` feature), so no network
+access is needed. The server answers with signed records after --latency-ms,
+so every uncached lookup is a full round trip through the bindings, the
+runtime and DNSSEC validation, and cached lookups return real answers.
+
+Usage:
+  ./setup_python.sh
+  python3 bench_python.py [--threads 16] [--calls 50] [--latency-ms 5] [--workers 2]
+                          [--batch 256] [--json out.json]
+"""
+
+import argparse
+import json
+import sys
+import threading
+import time
+
+sys.path.append('.')
+import bip353
+
+
+def run_threads(resolver, address, threads, calls):
+    """Run `calls` resolutions on each of `threads` threads, return ops/second and failures"""
+    barrier = threading.Barrier(threads + 1)
+    failures = []
+
+    def worker():
+        barrier.wait()
+        for _ in range(calls):
+            try:
+                resolver.resolve_address(address)
+            except RuntimeError as e:
+                failures.append(e)
+
+    workers = [threading.Thread(target=worker) for _ in range(threads)]
+    for w in workers:
+        w.start()
+    barrier.wait()
+    start = time.perf_counter()
+    for w in workers:
+        w.join()
+    elapsed = time.perf_counter() - start
+    return threads * calls / elapsed, len(failures)
+
+
+def run_batch(resolver, addresses, concurrency):
+    """Time a Python loop over resolve_address against one resolve_many call"""
+    start = time.perf_counter()
+    for address in addresses:
+        try:
+            resolver.resolve_address(address)
+        except RuntimeError:
+            pass
+    loop_elapsed = time.perf_counter() - start
+
+    start = time.perf_counter()
+    results = resolver.resolve_many(addresses, concurrency=concurrency)
+    batch_elapsed = time.perf_counter() - start
+    assert len(results) == len(addresses)
+    assert not any(isinstance(r, Exception) for r in results), "resolve_many failed"
+
+    return loop_elapsed / len(addresses), batch_elapsed / len(addresses)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--threads', type=int, default=16, help='maximum number of Python threads')
+    parser.add_argument('--calls', type=int, default=50, help='resolutions per thread')
+    parser.add_argument('--latency-ms', type=float, default=5.0, help='local DNS server latency')
+    parser.add_argument('--workers', type=int, default=2, help='runtime worker threads')
+    parser.add_argument('--batch', type=int, default=256, help='addresses per resolve_many call')
+    parser.add_argument('--concurrency', type=int, default=16, help='resolve_many concurrency')
+    parser.add_argument('--address', default='user1@example.com')
+    parser.add_argument('--json', help='write results to this file')
+    args = parser.parse_args()
+
+    bip353.init_runtime(worker_threads=args.workers)
+    server = bip353.LocalDnsServer(latency_ms=args.latency_ms)
+    uncached = server.resolver()
+    cached = server.resolver(enable_cache=True)
+    print(f"Local DNS server on {server.address} ({args.latency_ms}ms latency)\n")
+
+    # Fill the cache, and fail early if the address does not resolve
+    cached.resolve_address(args.address)
+
+    results = []
+    for bench, resolver, calls in [('resolve_address_threads', uncached, args.calls),
+                                   ('resolve_cached_threads', cached, args.calls * 20)]:
+        print(bench)
+        baseline = None
+        threads = 1
+        while threads <= args.threads:
+            ops, failures = run_threads(resolver, args.address, threads, calls)
+            baseline = baseline or ops
+            scaling = ops / baseline
+            results.append({'bench': bench, 'threads': threads, 'failures': failures,
+                            'ops_per_sec': round(ops, 1), 'scaling': round(scaling, 2)})
+            print(f"threads={threads:<3} {ops:10.1f} resolutions/s  scaling {scaling:5.2f}x "
+                  f"(ideal {threads}x)  failures {failures}")
+            threads *= 2
+        print()
+
+    # Distinct users, so resolve_many cannot deduplicate them away
+    domain = args.address.split('@', 1)[1]
+    addresses = [f"user{i}@{domain}" for i in range(args.batch)]
+    loop_per_item, batch_per_item = run_batch(uncached, addresses, args.concurrency)
+    results.append({'bench': 'resolve_many', 'batch': args.batch, 'concurrency': args.concurrency,
+                    'loop_us_per_item': round(loop_per_item * 1e6, 1),
+                    'batch_us_per_item': round(batch_per_item * 1e6, 1)})
+    print(f"batch of {args.batch}: resolve_address loop {loop_per_item * 1e6:10.1f} us/item, "
+          f"resolve_many {batch_per_item * 1e6:10.1f} us/item (concurrency {args.concurrency})")
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(results, f, indent=2)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,98 @@
+//! Allocations per resolution, by resolver stage
+//!
+//! Resolves names against an in-process HRN resolver on a single-threaded
+//! runtime and prints the mean allocations and bytes per resolution for each
+//! stage, uncached (distinct names) and cached (one name, repeated). Exits
+//! with an error when either exceeds its budget in `bip353::*_BUDGET`.
+//!
+//!     cargo bench --bench allocations --features alloc-profile [-- <resolutions>]
+
+use std::process::ExitCode;
+use std::time::Duration;
+
+use bip353::{
+    thread_stats,
+    AllocCount,
+    AllocStage,
+    AllocStats,
+    Bip353Resolver,
+    CountingAllocator,
+    ResolverConfig,
+    CACHED_RESOLUTION_BUDGET,
+    UNCACHED_RESOLUTION_BUDGET,
+};
+
+mod common;
+
+use common::StaticResolver;
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+fn main() -> ExitCode {
+    let resolutions: u64 = std::env::args().skip(1)
+        .find(|arg| !arg.starts_with("--"))
+        .and_then(|arg| arg.parse().ok())
+        .unwrap_or(10_000);
+    
+    let runtime = tokio::runtime::Builder::new_current_thread().enable_all().build().unwrap();
+    let config = ResolverConfig::default().with_cache_ttl(Duration::from_secs(3600));
+    let resolver = Bip353Resolver::with_hrn_resolver(StaticResolver, config);
+    let names: Vec<String> = (0..resolutions).map(|i| format!("user{}@example.com", i)).collect();
+    
+    // Runs on this thread, so the thread's counters see every allocation
+    let before = thread_stats();
+    runtime.block_on(async {
+        for name in &names {
+            resolver.resolve_address(name).await.unwrap();
+        }
+    });
+    let uncached = thread_stats().since(&before);
+    
+    let before = thread_stats();
+    runtime.block_on(async {
+        for _ in 0..resolutions {
+            resolver.resolve_address(&names[0]).await.unwrap();
+        }
+    });
+    let cached = thread_stats().since(&before);
+    
+    println!("{:<14} {:>14} {:>14} {:>14} {:>14}", "stage", "uncached", "bytes", "cached", "bytes");
+    for stage in AllocStage::ALL {
+        print_row(stage.as_str(), resolutions, &uncached, &cached, |stats| stats.get(stage));
+    }
+    print_row("total", resolutions, &uncached, &cached, AllocStats::total);
+    
+    let budgeted = (uncached.total().allocations - uncached.get(AllocStage::Instructions).allocations) as f64
+        / resolutions as f64;
+    let cached_mean = cached.total().allocations as f64 / resolutions as f64;
+    let mut status = ExitCode::SUCCESS;
+    if budgeted > UNCACHED_RESOLUTION_BUDGET as f64 {
+        eprintln!("uncached: {:.2} allocations outside instructions, budget {}", budgeted, UNCACHED_RESOLUTION_BUDGET);
+        status = ExitCode::FAILURE;
+    }
+    if cached_mean > CACHED_RESOLUTION_BUDGET as f64 {
+        eprintln!("cached: {:.2} allocations, budget {}", cached_mean, CACHED_RESOLUTION_BUDGET);
+        status = ExitCode::FAILURE;
+    }
+    status
+}
+
+fn print_row(
+    name: &str,
+    resolutions: u64,
+    uncached: &AllocStats,
+    cached: &AllocStats,
+    count: impl Fn(&AllocStats) -> AllocCount,
+) {
+    let per = |value: u64| value as f64 / resolutions as f64;
+    let (uncached, cached) = (count(uncached), count(cached));
+    println!(
+        "{:<14} {:>14.2} {:>14.1} {:>14.2} {:>14.1}",
+        name,
+        per(uncached.allocations),
+        per(uncached.bytes),
+        per(cached.allocations),
+        per(cached.bytes),
+    );
+}
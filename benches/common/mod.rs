@@ -0,0 +1,35 @@
+//! In-process HRN resolver shared by the benchmarks
+
+use bitcoin_payment_instructions::amount::Amount;
+use bitcoin_payment_instructions::hrn_resolution::{
+    HrnResolution,
+    HrnResolutionFuture,
+    HrnResolver,
+    HumanReadableName,
+    LNURLResolutionFuture,
+};
+
+/// Record every name resolves to
+pub const RECORD: &str = "bitcoin:bc1qar0srrr7xfkvy5l643lydnw9re59gtzzwf5mdq";
+
+/// HRN resolver that answers every name with `RECORD`, without a proof
+pub struct StaticResolver;
+
+impl HrnResolver for StaticResolver {
+    fn resolve_hrn<'a>(&'a self, _hrn: &'a HumanReadableName) -> HrnResolutionFuture<'a> {
+        Box::pin(async {
+            Ok(HrnResolution::DNSSEC {
+                proof: None,
+                result: RECORD.to_string(),
+            })
+        })
+    }
+    
+    fn resolve_lnurl<'a>(&'a self, _url: &'a str) -> HrnResolutionFuture<'a> {
+        Box::pin(async { Err("no records") })
+    }
+    
+    fn resolve_lnurl_to_invoice<'a>(&'a self, _: String, _: Amount, _: [u8; 32]) -> LNURLResolutionFuture<'a> {
+        Box::pin(async { Err("no records") })
+    }
+}
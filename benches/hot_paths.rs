@@ -0,0 +1,285 @@
+//! Criterion benchmarks of the resolution hot paths
+//!
+//! Every resolution runs against an in-process HRN resolver, or with the
+//! `testing` feature the local DNS server, so results do not depend on the
+//! network. Criterion keeps each benchmark's estimates as
+//! JSON under `target/criterion/<group>/<bench>/`. To compare commits, save
+//! a baseline on one and check another against it:
+//!
+//!     cargo bench --bench hot_paths --features ffi -- --save-baseline main
+//!     cargo bench --bench hot_paths --features ffi -- --baseline main
+//!
+//! Benchmark ids are part of that format; rename them only with care.
+
+use std::hint::black_box;
+use std::sync::{Arc, Barrier};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use bip353::middleware::{CacheLayer, Layer, Lookup, Resolve, ResolveResult};
+use bip353::{
+    parse_address,
+    Bip353Metrics,
+    Bip353Resolver,
+    CoreResolver,
+    LatencyOutcome,
+    PaymentInfo,
+    ResolverConfig,
+};
+use bitcoin_payment_instructions::PaymentInstructions;
+use criterion::{criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion};
+use tokio::runtime::Runtime;
+
+mod common;
+
+use common::{StaticResolver, RECORD};
+
+const THREADS: [usize; 3] = [1, 4, 16];
+
+fn runtime() -> Runtime {
+    tokio::runtime::Builder::new_current_thread().enable_all().build().unwrap()
+}
+
+fn bench_parse_address(c: &mut Criterion) {
+    let mut group = c.benchmark_group("parse_address");
+    for (name, address) in [
+        ("plain", "alice@example.com"),
+        ("prefixed", "₿alice@example.com"),
+        ("invalid", "alice.example.com"),
+    ] {
+        group.bench_with_input(BenchmarkId::from_parameter(name), address, |b, address| {
+            b.iter(|| parse_address(black_box(address)))
+        });
+    }
+    group.finish();
+}
+
+/// Instructions for `RECORD`, as `CoreResolver` parses them
+fn instructions(runtime: &Runtime) -> PaymentInstructions {
+    runtime.block_on(PaymentInstructions::parse(
+        "alice@example.com",
+        bitcoin::Network::Bitcoin,
+        &StaticResolver,
+        true,
+    )).unwrap()
+}
+
+fn bench_payment_info(c: &mut Criterion) {
+    let runtime = runtime();
+    let instructions = || instructions(&runtime);
+    
+    let mut group = c.benchmark_group("payment_info");
+    let parsed = instructions();
+    group.bench_function("uri", |b| {
+        b.iter(|| bip353::bench::payment_uri(black_box(&parsed)).unwrap())
+    });
+    for (name, uri) in [
+        ("plain", RECORD.to_string()),
+        ("parameters", format!("{}?amount=0.001&label=coffee&message=thanks", RECORD)),
+    ] {
+        group.bench_function(BenchmarkId::new("from_instructions", name), |b| {
+            b.iter_batched(
+                || (instructions(), uri.clone()),
+                |(instructions, uri)| PaymentInfo::from_instructions(instructions, uri),
+                BatchSize::SmallInput,
+            )
+        });
+    }
+    group.finish();
+}
+
+/// Instruction parsing, URI construction and `PaymentInfo`, below every layer
+fn bench_core_resolve(c: &mut Criterion) {
+    let runtime = runtime();
+    let core = CoreResolver::new(Arc::new(StaticResolver), bitcoin::Network::Bitcoin);
+    let lookup = Lookup::new("alice", "example.com");
+    
+    c.bench_function("core_resolve", |b| {
+        b.iter(|| runtime.block_on(core.resolve(black_box(&lookup))).unwrap())
+    });
+}
+
+/// Run `iters` operations split across `threads` threads, return the wall time
+///
+/// Each thread builds its operation with `make` before the clock starts.
+fn contended<M, F>(threads: usize, iters: u64, make: M) -> Duration
+where
+    M: Fn() -> F + Send + Sync + 'static,
+    F: FnMut(u64),
+{
+    let make = Arc::new(make);
+    let barrier = Arc::new(Barrier::new(threads + 1));
+    let per_thread = iters.div_ceil(threads as u64);
+    let workers: Vec<_> = (0..threads).map(|t| {
+        let make = make.clone();
+        let barrier = barrier.clone();
+        thread::spawn(move || {
+            let mut op = make();
+            barrier.wait();
+            for i in 0..per_thread {
+                op(t as u64 * per_thread + i);
+            }
+        })
+    }).collect();
+    
+    barrier.wait();
+    let start = Instant::now();
+    for worker in workers {
+        worker.join().unwrap();
+    }
+    start.elapsed()
+}
+
+/// Inner service that answers every lookup with the same `PaymentInfo`
+struct Answer(PaymentInfo);
+
+impl Resolve for Answer {
+    fn resolve<'a>(&'a self, _lookup: &'a Lookup) -> impl std::future::Future<Output = ResolveResult> + Send + 'a {
+        std::future::ready(Ok(self.0.clone()))
+    }
+}
+
+fn bench_cache_contention(c: &mut Criterion) {
+    let mut group = c.benchmark_group("address_cache");
+    
+    let config = ResolverConfig::default().with_cache_ttl(Duration::from_secs(3600));
+    let resolver = Arc::new(Bip353Resolver::with_hrn_resolver(StaticResolver, config));
+    runtime().block_on(resolver.resolve("alice", "example.com")).unwrap();
+    for threads in THREADS {
+        group.bench_function(BenchmarkId::new("hit", threads), |b| {
+            b.iter_custom(|iters| {
+                let resolver = resolver.clone();
+                contended(threads, iters, move || {
+                    let resolver = resolver.clone();
+                    move |_| {
+                        black_box(resolver.try_resolve_cached("alice", "example.com")).unwrap();
+                    }
+                })
+            })
+        });
+    }
+    
+    // The cache layer alone over a pre-built answer, so only the miss and the
+    // insert are timed. Names outnumber the entries 64 to 1, so lookups miss
+    // and every insert evicts the oldest entry.
+    let info = PaymentInfo::from_instructions(instructions(&runtime()), RECORD.to_string());
+    let inner = Arc::new(Answer(info));
+    let layer = Arc::new(CacheLayer::with_capacity(Duration::from_secs(3600), 1024));
+    let lookups: Arc<Vec<Lookup>> = Arc::new((0..65536).map(|i| Lookup::new(&format!("user{}", i), "example.com")).collect());
+    for threads in THREADS {
+        group.bench_function(BenchmarkId::new("miss_insert", threads), |b| {
+            b.iter_custom(|iters| {
+                let (layer, inner, lookups) = (layer.clone(), inner.clone(), lookups.clone());
+                contended(threads, iters, move || {
+                    let (layer, inner, lookups) = (layer.clone(), inner.clone(), lookups.clone());
+                    move |i| {
+                        let lookup = &lookups[i as usize % lookups.len()];
+                        futures::executor::block_on(layer.call(&*inner, lookup)).unwrap();
+                    }
+                })
+            })
+        });
+    }
+    group.finish();
+}
+
+fn bench_metrics(c: &mut Criterion) {
+    let metrics = Bip353Metrics::new();
+    let mut group = c.benchmark_group("metrics");
+    group.bench_function("record_cache_hit", |b| b.iter(|| metrics.record_cache_hit()));
+    group.bench_function("record_latency", |b| {
+        b.iter(|| metrics.record_latency(LatencyOutcome::CacheHit, black_box(Duration::from_micros(250))))
+    });
+    group.bench_function("record_resolution_success", |b| {
+        b.iter(|| metrics.record_resolution_success(black_box("example.com"), Duration::from_micros(250)))
+    });
+    group.finish();
+}
+
+/// Full resolutions through `Bip353Resolver`, with the default layers
+fn bench_end_to_end(c: &mut Criterion) {
+    let runtime = runtime();
+    let mut group = c.benchmark_group("resolve_address");
+    for (name, config) in [
+        ("uncached", ResolverConfig::default()),
+        ("cached", ResolverConfig::default().with_cache_ttl(Duration::from_secs(3600))),
+        ("cached_metrics", ResolverConfig::default().with_cache_ttl(Duration::from_secs(3600)).with_metrics(true)),
+    ] {
+        let resolver = Bip353Resolver::with_hrn_resolver(StaticResolver, config);
+        group.bench_function(name, |b| {
+            b.iter(|| runtime.block_on(resolver.resolve_address(black_box("alice@example.com"))).unwrap())
+        });
+    }
+    group.finish();
+}
+
+/// C API calls with their result conversion and `bip353_result_free`
+#[cfg(feature = "ffi")]
+fn bench_ffi(c: &mut Criterion) {
+    use std::ffi::CString;
+    use bip353::ffi::*;
+    use bip353::DynHrnResolver;
+    
+    let config = ResolverConfig::default().with_cache_ttl(Duration::from_secs(3600));
+    let resolver = ResolverPtr::into_raw(Bip353Resolver::with_hrn_resolver(DynHrnResolver::new(StaticResolver), config));
+    let address = CString::new("alice@example.com").unwrap();
+    bip353_result_free(bip353_resolve_address(resolver, address.as_ptr()));
+    
+    let mut group = c.benchmark_group("ffi");
+    group.bench_function("resolve_address_free", |b| {
+        b.iter(|| bip353_result_free(bip353_resolve_address(resolver, address.as_ptr())))
+    });
+    group.bench_function("try_resolve_cached_free", |b| {
+        b.iter(|| bip353_result_free(bip353_try_resolve_cached(resolver, address.as_ptr(), 0)))
+    });
+    group.finish();
+    
+    bip353_resolver_free(resolver);
+}
+
+#[cfg(not(feature = "ffi"))]
+fn bench_ffi(_: &mut Criterion) {}
+
+/// Validated resolutions from the local DNS server, over loopback UDP
+#[cfg(feature = "testing")]
+fn bench_local_dns(c: &mut Criterion) {
+    use std::sync::atomic::{AtomicU64, Ordering};
+    use bip353::testing::{DnsServer, DnsServerConfig};
+    
+    let runtime = tokio::runtime::Builder::new_multi_thread().enable_all().build().unwrap();
+    let server = DnsServer::start(DnsServerConfig::default()).unwrap();
+    let mut group = c.benchmark_group("local_dns");
+    
+    // Distinct users of the million-user zone, so every resolution misses
+    let resolver = Bip353Resolver::with_hrn_resolver(server.resolver(), ResolverConfig::default());
+    let next = AtomicU64::new(0);
+    group.bench_function("uncached", |b| {
+        b.iter(|| {
+            let user = format!("user{}", next.fetch_add(1, Ordering::Relaxed) % 1_000_000);
+            runtime.block_on(resolver.resolve(&user, "example.com")).unwrap()
+        })
+    });
+    
+    let config = ResolverConfig::default().with_cache_ttl(Duration::from_secs(3600));
+    let resolver = Bip353Resolver::with_hrn_resolver(server.resolver(), config);
+    group.bench_function("cached", |b| {
+        b.iter(|| runtime.block_on(resolver.resolve_address("user1@example.com")).unwrap())
+    });
+    group.finish();
+}
+
+#[cfg(not(feature = "testing"))]
+fn bench_local_dns(_: &mut Criterion) {}
+
+criterion_group!(
+    benches,
+    bench_parse_address,
+    bench_payment_info,
+    bench_core_resolve,
+    bench_cache_contention,
+    bench_metrics,
+    bench_end_to_end,
+    bench_ffi,
+    bench_local_dns,
+);
+criterion_main!(benches);
@@ -0,0 +1,95 @@
+//! Cost of recording metrics under contention
+//!
+//! Runs each `Bip353Metrics` recording method on 1 to 64 threads and reports
+//! the core time per call (wall time x busy cores / calls), next to a single
+//! shared `AtomicU64` as the contended baseline. With per-thread shards the
+//! cost per call should stay flat as threads are added.
+//!
+//!     cargo bench --bench metrics_recording [-- <calls per thread>]
+
+use std::hint::black_box;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Barrier};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use bip353::{Bip353Metrics, LatencyOutcome};
+
+const THREADS: [usize; 7] = [1, 2, 4, 8, 16, 32, 64];
+
+/// Run `op` `calls` times on each of `threads` threads, return core-ns per call
+fn run<F>(threads: usize, calls: u64, op: F) -> f64
+where
+    F: Fn(u64) + Send + Sync + 'static,
+{
+    let op = Arc::new(op);
+    let barrier = Arc::new(Barrier::new(threads + 1));
+    let workers: Vec<_> = (0..threads).map(|_| {
+        let op = op.clone();
+        let barrier = barrier.clone();
+        thread::spawn(move || {
+            barrier.wait();
+            for i in 0..calls {
+                op(black_box(i));
+            }
+        })
+    }).collect();
+    
+    barrier.wait();
+    let start = Instant::now();
+    for worker in workers {
+        worker.join().unwrap();
+    }
+    let elapsed = start.elapsed().as_nanos() as f64;
+    
+    let cores = thread::available_parallelism().map_or(1, |n| n.get());
+    elapsed * threads.min(cores) as f64 / (calls * threads as u64) as f64
+}
+
+fn main() {
+    let calls: u64 = std::env::args().skip(1)
+        .find(|arg| !arg.starts_with("--"))
+        .and_then(|arg| arg.parse().ok())
+        .unwrap_or(1_000_000);
+    
+    println!("{:<34} {}", "core-ns per call / threads", THREADS.map(|t| format!("{:>8}", t)).join(""));
+    
+    // Four times the domains `Bip353Metrics::new` tracks
+    let domains: Arc<[String]> = (0..256).map(|i| format!("d{}.example", i)).collect();
+    
+    let benches: [(&str, fn(&Bip353Metrics, &[String], u64)); 5] = [
+        ("record_cache_hit", |m, _, _| m.record_cache_hit()),
+        ("record_latency", |m, _, i| m.record_latency(LatencyOutcome::CacheHit, Duration::from_micros(i % 5000))),
+        // Every thread hits the same bucket, the worst case for shared buckets
+        ("record_latency, one bucket", |m, _, _| m.record_latency(LatencyOutcome::CacheHit, Duration::from_micros(250))),
+        ("record_resolution_success", |m, _, i| m.record_resolution_success("example.com", Duration::from_micros(i % 5000))),
+        // More domains than are tracked, so most recordings evict one
+        ("record_resolution_success, churn", |m, domains, i| {
+            m.record_resolution_success(&domains[i as usize % domains.len()], Duration::from_micros(i % 5000))
+        }),
+    ];
+    
+    let mut row = Vec::new();
+    for threads in THREADS {
+        let shared = Arc::new(AtomicU64::new(0));
+        row.push(run(threads, calls, move |_| {
+            black_box(&*shared).fetch_add(1, Ordering::Relaxed);
+        }));
+    }
+    print_row("shared AtomicU64 (baseline)", &row);
+    
+    for (name, bench) in benches {
+        let mut row = Vec::new();
+        for threads in THREADS {
+            let metrics = Arc::new(Bip353Metrics::new());
+            let domains = domains.clone();
+            row.push(run(threads, calls, move |i| bench(&metrics, &domains, i)));
+        }
+        print_row(name, &row);
+    }
+}
+
+fn print_row(name: &str, row: &[f64]) {
+    let cells: String = row.iter().map(|ns| format!("{:>8.1}", ns)).collect();
+    println!("{:<34} {}", name, cells);
+}
@@ -1,6 +1,6 @@
 /// This is real scenario testing for the library
 
-use bip353::{Bip353Resolver, ResolverConfig};
+use bip353::{Bip353Resolver, FlightRecorderConfig, ResolverConfig};
 use clap::{Parser, Subcommand};
 use std::time::{Duration, Instant};
 
@@ -23,6 +23,14 @@ struct Cli {
     /// Timeout in seconds
     #[arg(short, long, default_value = "10")]
     timeout: u64,
+    
+    /// Record resolutions and dump them as JSON lines when done
+    #[arg(long)]
+    flight_recorder: bool,
+    
+    /// Pin resolutions at least this slow (milliseconds) in the flight recorder
+    #[arg(long, default_value = "1000")]
+    slow_ms: u64,
 }
 
 #[derive(Subcommand)]
@@ -82,11 +90,12 @@ async fn test_resolve(address: String, cli: &Cli) -> Result<(), Box<dyn std::err
     let resolver = Bip353Resolver::with_config(config)?;
     
     let start = Instant::now();
+    let result = resolver.resolve_address(&address).await;
+    let duration = start.elapsed();
+    dump_flight_recorder(&resolver);
     
-    match resolver.resolve_address(&address).await {
+    match result {
         Ok(info) => {
-            let duration = start.elapsed();
-            
             println!("✅ Resolution successful! ({}ms)", duration.as_millis());
             println!("   🔗 URI: {}", info.uri);
             println!("   💳 Type: {:?}", info.payment_type);
@@ -121,7 +130,6 @@ async fn test_resolve(address: String, cli: &Cli) -> Result<(), Box<dyn std::err
             }
         }
         Err(e) => {
-            let duration = start.elapsed();
             eprintln!("❌ Resolution failed after {}ms: {}", duration.as_millis(), e);
             
             // Provide debugging info
@@ -178,6 +186,7 @@ async fn test_known_addresses(cli: &Cli) -> Result<(), Box<dyn std::error::Error
     }
     
     println!("📊 Results: {}/{} addresses resolved successfully", successful, total);
+    dump_flight_recorder(&resolver);
     
     if successful == 0 {
         println!("💡 This is normal - BIP-353 is very new and most domains don't support it yet!");
@@ -257,6 +266,8 @@ async fn test_enhanced(address: String, repeat: usize, cli: &Cli) -> Result<(),
         println!("   Success rate: {:.1}%", metrics.success_rate * 100.0);
     }
     
+    dump_flight_recorder(&resolver);
+    
     // Test cache management
     println!("\n🧹 Testing cache management:");
     resolver.invalidate_cache(&address).await;
@@ -273,10 +284,9 @@ async fn benchmark_resolution(address: String, iterations: usize, cli: &Cli) ->
     println!("   Address: {}", address);
     println!("   Iterations: {}", iterations);
     
-    let config = create_config(cli)?;
+    let config = create_config(cli)?.with_metrics(true);
     let resolver = Bip353Resolver::with_config(config)?;
     
-    let mut times = Vec::with_capacity(iterations);
     let mut successful = 0;
     
     println!("\n🏃 Running benchmark...");
@@ -287,15 +297,8 @@ async fn benchmark_resolution(address: String, iterations: usize, cli: &Cli) ->
             println!("   Completed {}/{} iterations", i, iterations);
         }
         
-        let start = Instant::now();
-        match resolver.resolve_address(&address).await {
-            Ok(_) => {
-                successful += 1;
-                times.push(start.elapsed());
-            }
-            Err(_) => {
-                times.push(start.elapsed());
-            }
+        if resolver.resolve_address(&address).await.is_ok() {
+            successful += 1;
         }
     }
     
@@ -305,28 +308,23 @@ async fn benchmark_resolution(address: String, iterations: usize, cli: &Cli) ->
     println!("   Total time: {}ms", total_time.as_millis());
     println!("   Successful resolutions: {}/{}", successful, iterations);
     
-    if !times.is_empty() {
-        let avg_time = times.iter().sum::<Duration>() / times.len() as u32;
-        
-        // Clone times for sorting to avoid borrow checker issues
-        let mut sorted_times = times.clone();
-        sorted_times.sort();
-        
-        let min_time = times.iter().min().unwrap();
-        let max_time = times.iter().max().unwrap();
-        let p50 = sorted_times[sorted_times.len() / 2];
-        let p95 = sorted_times[(sorted_times.len() * 95) / 100];
-        let p99 = sorted_times[(sorted_times.len() * 99) / 100];
-        
-        println!("   Average: {}ms", avg_time.as_millis());
-        println!("   Min: {}ms", min_time.as_millis());
-        println!("   Max: {}ms", max_time.as_millis());
-        println!("   P50 (median): {}ms", p50.as_millis());
-        println!("   P95: {}ms", p95.as_millis());
-        println!("   P99: {}ms", p99.as_millis());
+    if let Some(stats) = resolver.get_latency_stats() {
+        for (label, summary) in [("Resolved", &stats.cache_miss), ("Failed", &stats.error)] {
+            if summary.count == 0 {
+                continue;
+            }
+            println!("   {} ({}):", label, summary.count);
+            println!("     Mean: {}ms", summary.mean.as_millis());
+            println!("     P50 (median): {}ms", summary.p50.as_millis());
+            println!("     P90: {}ms", summary.p90.as_millis());
+            println!("     P99: {}ms", summary.p99.as_millis());
+            println!("     P99.9: {}ms", summary.p999.as_millis());
+            println!("     Max: {}ms", summary.max.as_millis());
+        }
         println!("   Throughput: {:.1} resolutions/second", iterations as f64 / total_time.as_secs_f64());
     }
     
+    dump_flight_recorder(&resolver);
     Ok(())
 }
 
@@ -351,5 +349,20 @@ fn create_config(cli: &Cli) -> Result<ResolverConfig, Box<dyn std::error::Error>
         _ => return Err(format!("Unknown network: {}", cli.network).into()),
     };
     
-    Ok(base_config.with_timeout(Duration::from_secs(cli.timeout)))
+    let config = base_config.with_timeout(Duration::from_secs(cli.timeout));
+    if !cli.flight_recorder {
+        return Ok(config);
+    }
+    
+    Ok(config.with_flight_recorder(FlightRecorderConfig {
+        slow_threshold: Duration::from_millis(cli.slow_ms),
+        ..FlightRecorderConfig::default()
+    }))
+}
+
+fn dump_flight_recorder(resolver: &Bip353Resolver) {
+    if let Some(recorder) = resolver.flight_recorder() {
+        println!("\n🛩  Flight recorder:");
+        print!("{}", recorder.dump_json());
+    }
 }
\ No newline at end of file
@@ -10,6 +10,8 @@
 #ifndef BIP353_H
 #define BIP353_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -39,6 +41,68 @@ typedef struct Bip353Result {
     char* error;
 } Bip353Result;
 
+/**
+ * How a resolution was answered
+ */
+typedef struct Bip353Report {
+    /** 1 if answered from the cache */
+    int cache_hit;
+    
+    /** 1 if an expired cache entry was refreshed */
+    int stale;
+    
+    /** 1 if the answer came from a concurrent lookup of the same name */
+    int coalesced;
+    
+    /** DNS resolver queried as "ip:port", empty if no DNS query was sent */
+    char upstream[64];
+    
+    /** Time spent in lookups, including DNSSEC validation, in microseconds */
+    uint64_t rtt_us;
+    
+    /** Lookups sent to the upstream */
+    uint32_t queries;
+    
+    /** Bytes of DNSSEC proofs and records received */
+    uint64_t bytes_received;
+    
+    /** Time spent parsing instructions and building the URI, in microseconds */
+    uint64_t processing_us;
+    
+    /** Wall time of the resolution in microseconds */
+    uint64_t total_us;
+    
+    /** Seconds until the cached answer expires, -1 if not cached */
+    int64_t ttl_remaining_secs;
+} Bip353Report;
+
+/**
+ * Initialize the library runtime
+ * 
+ * Optional. Without it, a runtime with 2 worker threads is started on the
+ * first resolution. Must be called before any resolution to take effect.
+ * 
+ * @param worker_threads Number of worker threads (0 for the default)
+ * @param thread_name_prefix Prefix for worker thread names, or NULL for "bip353"
+ * @param current_thread Non-zero to run without worker threads; resolutions
+ *                       are then driven by the calling threads, and
+ *                       bip353_resolve_address_async is unavailable
+ * @return 1 on success, 0 if already initialized or on error
+ */
+int bip353_init(uint32_t worker_threads, const char* thread_name_prefix, int current_thread);
+
+/**
+ * Shut down the library runtime
+ * 
+ * Waits for in-flight requests to finish, then joins the worker threads.
+ * The runtime is started again on demand by later calls.
+ * 
+ * @param timeout_ms Maximum time to wait for in-flight requests (0 = no limit)
+ * @return 1 if the runtime was fully shut down, 0 if requests were still running,
+ *         -1 if called from a library thread such as a bip353_result_callback
+ */
+int bip353_shutdown(uint64_t timeout_ms);
+
 /**
  * Create a new resolver with default configuration
  * 
@@ -54,6 +118,95 @@ ResolverPtr* bip353_resolver_create(void);
  */
 ResolverPtr* bip353_resolver_create_with_network(const char* network_name);
 
+/**
+ * Current version of the Bip353Config layout
+ */
+#define BIP353_CONFIG_VERSION 1
+
+/**
+ * Resolver configuration
+ *
+ * Always initialize with bip353_config_init() before setting fields. The
+ * struct is size-prefixed: fields appended in later versions keep their
+ * defaults when an older caller passes a smaller struct_size, and a caller
+ * built against a newer header may pass a larger one as long as the fields
+ * this library doesn't know about are zero. Any other struct_size is
+ * rejected.
+ */
+typedef struct Bip353Config {
+    /** sizeof(Bip353Config), set by bip353_config_init() */
+    uint32_t struct_size;
+    
+    /** BIP353_CONFIG_VERSION, set by bip353_config_init() */
+    uint32_t version;
+    
+    /** Network name ("main", "testnet", "signet" or "regtest"), NULL for mainnet */
+    const char* network;
+    
+    /** DNS resolver as "ip:port", NULL for the default (8.8.8.8:53) */
+    const char* dns_resolver;
+    
+    /**
+     * Deadline for each lookup attempt in milliseconds, applied only when
+     * enforce_timeout is set. Also the deadline used when
+     * bip353_resolve_address_with_deadline or bip353_resolve_address_async
+     * is passed 0.
+     */
+    uint64_t timeout_ms;
+    
+    /** Reserved: DNSSEC is always validated; must stay 1 (the default) */
+    int enforce_dnssec;
+    
+    /** Reserved: HTTP fallback is not implemented; must stay 0 (the default) */
+    int allow_http_fallback;
+    
+    /** Whether to cache resolved addresses */
+    int enable_cache;
+    
+    /** Whether to collect metrics */
+    int enable_metrics;
+    
+    /** Cache entry lifetime in seconds */
+    uint64_t cache_ttl_secs;
+    
+    /** Maximum number of cached entries (0 = unbounded) */
+    uint64_t cache_max_entries;
+    
+    /** Whether concurrent lookups of the same name share one query */
+    int single_flight;
+    
+    /** Whether timeout_ms is enforced on each lookup attempt */
+    int enforce_timeout;
+    
+    /** Retries for transient failures (0 = no retry layer) */
+    uint32_t max_retries;
+    
+    /** Lookups per second reaching the network (0 = unlimited) */
+    uint32_t rate_limit_per_sec;
+    
+    /** Recent resolutions kept by the flight recorder (0 = disabled) */
+    uint32_t flight_recorder_capacity;
+    
+    /** Resolutions at least this slow are pinned in the flight recorder */
+    uint32_t slow_query_ms;
+} Bip353Config;
+
+/**
+ * Initialize a config with default values
+ * 
+ * @param config The config to initialize
+ */
+void bip353_config_init(Bip353Config* config);
+
+/**
+ * Create a new resolver from a full configuration
+ * 
+ * @param config The configuration (initialized with bip353_config_init)
+ * @return A pointer to the resolver, or NULL on an invalid configuration,
+ *         including a reserved field changed from its default
+ */
+ResolverPtr* bip353_resolver_create_with_config(const Bip353Config* config);
+
 /**
  * Free a resolver
  * 
@@ -61,6 +214,43 @@ ResolverPtr* bip353_resolver_create_with_network(const char* network_name);
  */
 void bip353_resolver_free(ResolverPtr* ptr);
 
+/**
+ * Opaque local DNS server for tests and benchmarks
+ * 
+ * The bip353_test_server_* and bip353_resolver_create_local functions are
+ * only exported by a library built with `--features ffi,testing`.
+ */
+typedef struct Bip353TestServer Bip353TestServer;
+
+/**
+ * Start a local DNS server with signed zones on localhost
+ * 
+ * Serves user0@example.com to user{users - 1}@example.com.
+ * 
+ * @param users Number of users served
+ * @param latency_us Delay before every response in microseconds
+ * @return A pointer to the server, or NULL if it cannot bind. Must be freed with bip353_test_server_free
+ */
+Bip353TestServer* bip353_test_server_start(uint64_t users, uint64_t latency_us);
+
+/**
+ * Stop and free a local DNS server
+ * 
+ * Resolvers created over it stay valid, but their lookups fail from then on.
+ * 
+ * @param server The server to free
+ */
+void bip353_test_server_free(Bip353TestServer* server);
+
+/**
+ * Create a resolver that looks names up on a local DNS server
+ * 
+ * @param server The server, which must outlive the lookups
+ * @param config The configuration; its dns_resolver is ignored
+ * @return A pointer to the resolver, or NULL on an invalid configuration
+ */
+ResolverPtr* bip353_resolver_create_local(const Bip353TestServer* server, const Bip353Config* config);
+
 /**
  * Resolve a human-readable Bitcoin address
  * 
@@ -70,6 +260,17 @@ void bip353_resolver_free(ResolverPtr* ptr);
  */
 Bip353Result* bip353_resolve_address(const ResolverPtr* ptr, const char* address);
 
+/**
+ * Resolve a human-readable Bitcoin address and report how it was answered
+ * 
+ * @param ptr The resolver
+ * @param address The address to resolve (e.g. "₿user@domain")
+ * @param report_out Filled whenever a result is returned, including failures
+ * @return A pointer to the result, or NULL on error
+ */
+Bip353Result* bip353_resolve_address_with_report(const ResolverPtr* ptr, const char* address,
+                                                 Bip353Report* report_out);
+
 /**
  * Resolve a human-readable Bitcoin address from user and domain parts
  * 
@@ -80,6 +281,96 @@ Bip353Result* bip353_resolve_address(const ResolverPtr* ptr, const char* address
  */
 Bip353Result* bip353_resolve(const ResolverPtr* ptr, const char* user, const char* domain);
 
+/**
+ * Opaque cancellation handle for a single resolution
+ */
+typedef struct Bip353Request Bip353Request;
+
+/**
+ * Create a cancellation handle
+ * 
+ * A handle covers exactly one resolve call.
+ * 
+ * @return A pointer to the handle
+ */
+Bip353Request* bip353_request_create(void);
+
+/**
+ * Cancel the resolution associated with a handle
+ * 
+ * Safe to call from any thread. The in-flight lookup is dropped, releasing
+ * its upstream connection, and the call completes with a "Cancelled" error.
+ * 
+ * @param request The handle
+ */
+void bip353_request_cancel(const Bip353Request* request);
+
+/**
+ * Free a cancellation handle
+ * 
+ * Must not be called while another thread may still cancel it.
+ * 
+ * @param request The handle to free
+ */
+void bip353_request_free(Bip353Request* request);
+
+/**
+ * Resolve a human-readable Bitcoin address with a deadline
+ * 
+ * @param ptr The resolver
+ * @param address The address to resolve (e.g. "₿user@domain")
+ * @param timeout_ms Deadline in milliseconds (0 for the resolver's configured timeout)
+ * @param request Cancellation handle, or NULL
+ * @return A pointer to the result, or NULL on error
+ */
+Bip353Result* bip353_resolve_address_with_deadline(const ResolverPtr* ptr, const char* address,
+                                                   uint64_t timeout_ms, const Bip353Request* request);
+
+/**
+ * Callback receiving the result of an asynchronous resolution
+ * 
+ * Runs on a library worker thread and owns the result, which must be freed
+ * with bip353_result_free. It should return quickly.
+ * 
+ * It must not make blocking calls: the bip353_resolve* functions that wait
+ * for an answer return an error result, and bip353_shutdown returns -1
+ * without shutting down (the callback's own request keeps the runtime busy).
+ * Use bip353_resolve_address_async or bip353_try_resolve_cached instead.
+ */
+typedef void (*bip353_result_callback)(Bip353Result* result, void* user_data);
+
+/**
+ * Resolve a human-readable Bitcoin address without blocking
+ * 
+ * Requires a runtime with worker threads (see bip353_init).
+ * 
+ * @param ptr The resolver (may be freed while the resolution is in flight)
+ * @param address The address to resolve (copied before returning)
+ * @param timeout_ms Deadline in milliseconds (0 for the resolver's configured timeout)
+ * @param request Cancellation handle, or NULL
+ * @param callback Invoked exactly once with the result
+ * @param user_data Passed through to the callback
+ * @return 1 if the resolution was started, 0 on invalid arguments or a runtime
+ *         initialized with current_thread (the callback is then never invoked)
+ */
+int bip353_resolve_address_async(const ResolverPtr* ptr, const char* address,
+                                 uint64_t timeout_ms, const Bip353Request* request,
+                                 bip353_result_callback callback, void* user_data);
+
+/**
+ * Look up a cached resolution without blocking
+ * 
+ * Never performs network I/O on the calling thread. Requires a resolver
+ * created with caching enabled (see Bip353Config).
+ * 
+ * @param ptr The resolver
+ * @param address The address to look up (e.g. "₿user@domain")
+ * @param schedule_fill Non-zero to start a background resolution on a miss,
+ *                      unless one is running or the runtime has no worker threads
+ * @return A pointer to the result on a fresh cache hit, NULL on a miss
+ */
+Bip353Result* bip353_try_resolve_cached(const ResolverPtr* ptr, const char* address, int schedule_fill);
+
 /**
  * Free a result
  * 
@@ -97,6 +388,25 @@ void bip353_result_free(Bip353Result* ptr);
  */
 int bip353_parse_address(const char* address, char** user_out, char** domain_out);
 
+/**
+ * Render the resolver's metrics in OpenMetrics text format
+ * 
+ * @param ptr The resolver
+ * @return The metrics text, or NULL if metrics are disabled. Must be freed with bip353_string_free
+ */
+char* bip353_metrics_render(const ResolverPtr* ptr);
+
+/**
+ * Dump the flight recorder as JSON lines, oldest first
+ * 
+ * Each line holds the name hash, start time, stage timings, outcome, cache
+ * status, upstream and whether the entry was pinned as a slow query.
+ * 
+ * @param ptr The resolver
+ * @return The records, or NULL if the flight recorder is disabled. Must be freed with bip353_string_free
+ */
+char* bip353_flight_recorder_dump(const ResolverPtr* ptr);
+
 /**
  * Free a string
  * 
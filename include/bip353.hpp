@@ -0,0 +1,347 @@
+/**
+ * BIP-353 Integrations - C++ API
+ *
+ * Header-only C++17 wrapper around the C API in bip353.h. Resolvers,
+ * results and cancellation handles are RAII types, result strings are
+ * exposed as std::string_view into the library-owned buffers, and
+ * asynchronous resolution is available as a std::future or, with C++20,
+ * as a coroutine awaitable.
+ */
+
+#ifndef BIP353_HPP
+#define BIP353_HPP
+
+#include "bip353.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define BIP353_HAS_COROUTINES 1
+#endif
+#endif
+
+namespace bip353 {
+
+/**
+ * Error raised when the library rejects a call (invalid arguments,
+ * invalid configuration, resolver creation failure)
+ */
+class Error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Initialize the library runtime (see bip353_init)
+ */
+inline bool init(unsigned worker_threads, const char* thread_name_prefix = nullptr,
+                 bool current_thread = false) noexcept {
+    return bip353_init(worker_threads, thread_name_prefix, current_thread ? 1 : 0) != 0;
+}
+
+/**
+ * Shut down the library runtime (see bip353_shutdown)
+ */
+inline bool shutdown(std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) noexcept {
+    return bip353_shutdown(static_cast<uint64_t>(timeout.count())) == 1;
+}
+
+/**
+ * User and domain parts of a parsed address
+ *
+ * Owns the library-allocated strings; the accessors view them without copying.
+ */
+class Address {
+public:
+    Address(char* user, char* domain) noexcept : user_(user), domain_(domain) {}
+
+    std::string_view user() const noexcept { return user_.get(); }
+    std::string_view domain() const noexcept { return domain_.get(); }
+
+private:
+    struct Deleter {
+        void operator()(char* s) const noexcept { bip353_string_free(s); }
+    };
+
+    std::unique_ptr<char, Deleter> user_;
+    std::unique_ptr<char, Deleter> domain_;
+};
+
+/**
+ * Parse a human-readable Bitcoin address into user and domain parts
+ */
+inline std::optional<Address> parse_address(const char* address) {
+    char* user = nullptr;
+    char* domain = nullptr;
+    if (!bip353_parse_address(address, &user, &domain)) {
+        return std::nullopt;
+    }
+    return Address(user, domain);
+}
+
+/**
+ * Resolver configuration, initialized with the library defaults
+ */
+struct Config : Bip353Config {
+    Config() noexcept { bip353_config_init(this); }
+};
+
+/**
+ * Result of a resolution
+ *
+ * Owns the underlying Bip353Result. An empty Result (e.g. a cache miss)
+ * is neither a success nor carries an error message.
+ */
+class Result {
+public:
+    Result() noexcept = default;
+    explicit Result(Bip353Result* raw) noexcept : raw_(raw) {}
+
+    bool ok() const noexcept { return raw_ && raw_->success; }
+    explicit operator bool() const noexcept { return ok(); }
+    bool empty() const noexcept { return !raw_; }
+
+    /** The URI (BIP-21), empty on failure */
+    std::string_view uri() const noexcept { return view(raw_ ? raw_->uri : nullptr); }
+
+    /** The payment type, empty on failure */
+    std::string_view payment_type() const noexcept { return view(raw_ ? raw_->payment_type : nullptr); }
+
+    /** Whether the payment is reusable */
+    bool is_reusable() const noexcept { return raw_ && raw_->is_reusable; }
+
+    /** Error message, empty on success */
+    std::string_view error() const noexcept { return view(raw_ ? raw_->error : nullptr); }
+
+    const Bip353Result* get() const noexcept { return raw_.get(); }
+    Bip353Result* release() noexcept { return raw_.release(); }
+
+private:
+    static std::string_view view(const char* s) noexcept {
+        return s ? std::string_view(s) : std::string_view();
+    }
+
+    struct Deleter {
+        void operator()(Bip353Result* raw) const noexcept { bip353_result_free(raw); }
+    };
+
+    std::unique_ptr<Bip353Result, Deleter> raw_;
+};
+
+/**
+ * Cancellation handle for a single resolution
+ *
+ * May be destroyed while its resolution is still running; cancel() must not
+ * race with destruction.
+ */
+class Request {
+public:
+    Request() : raw_(bip353_request_create()) {}
+
+    void cancel() const noexcept { bip353_request_cancel(raw_.get()); }
+    const Bip353Request* get() const noexcept { return raw_.get(); }
+
+private:
+    struct Deleter {
+        void operator()(Bip353Request* raw) const noexcept { bip353_request_free(raw); }
+    };
+
+    std::unique_ptr<Bip353Request, Deleter> raw_;
+};
+
+#ifdef BIP353_HAS_COROUTINES
+class ResolveAwaitable;
+#endif
+
+/**
+ * BIP-353 resolver
+ *
+ * Thread-safe: one Resolver may be shared by any number of threads.
+ */
+class Resolver {
+public:
+    /** Create a resolver with the default configuration */
+    Resolver() : Resolver(bip353_resolver_create()) {}
+
+    /** Create a resolver from a full configuration */
+    explicit Resolver(const Bip353Config& config) : Resolver(bip353_resolver_create_with_config(&config)) {}
+
+    /** Create a resolver for a network ("main", "testnet", "signet" or "regtest") */
+    static Resolver for_network(const char* network_name) {
+        return Resolver(bip353_resolver_create_with_network(network_name));
+    }
+
+    /**
+     * Create a resolver over a local DNS server (see bip353_resolver_create_local)
+     *
+     * Only available with a library built with `--features ffi,testing`.
+     */
+    static Resolver local(const Bip353TestServer* server, const Bip353Config& config) {
+        return Resolver(bip353_resolver_create_local(server, &config));
+    }
+
+    /** Resolve an address, blocking the calling thread */
+    Result resolve(const char* address) const {
+        return checked(bip353_resolve_address(raw_.get(), address));
+    }
+
+    Result resolve(const std::string& address) const { return resolve(address.c_str()); }
+
+    /** Resolve an address, blocking, and fill `report` with how it was answered */
+    Result resolve(const char* address, Bip353Report& report) const {
+        return checked(bip353_resolve_address_with_report(raw_.get(), address, &report));
+    }
+
+    Result resolve(const std::string& address, Bip353Report& report) const {
+        return resolve(address.c_str(), report);
+    }
+
+    /** Resolve an address under a deadline, optionally cancellable */
+    Result resolve(const char* address, std::chrono::milliseconds timeout,
+                   const Request* request = nullptr) const {
+        return checked(bip353_resolve_address_with_deadline(
+            raw_.get(), address, static_cast<uint64_t>(timeout.count()), request ? request->get() : nullptr));
+    }
+
+    Result resolve(const std::string& address, std::chrono::milliseconds timeout,
+                   const Request* request = nullptr) const {
+        return resolve(address.c_str(), timeout, request);
+    }
+
+    /** Return a fresh cached result without blocking; empty on a miss */
+    Result try_cached(const char* address, bool schedule_fill = false) const noexcept {
+        return Result(bip353_try_resolve_cached(raw_.get(), address, schedule_fill ? 1 : 0));
+    }
+
+    Result try_cached(const std::string& address, bool schedule_fill = false) const noexcept {
+        return try_cached(address.c_str(), schedule_fill);
+    }
+
+    /**
+     * Resolve an address without blocking
+     *
+     * A zero timeout uses the resolver's configured timeout.
+     */
+    std::future<Result> resolve_async(const std::string& address,
+                                      std::chrono::milliseconds timeout = std::chrono::milliseconds(0),
+                                      const Request* request = nullptr) const {
+        auto promise = std::make_unique<std::promise<Result>>();
+        std::future<Result> future = promise->get_future();
+
+        if (!bip353_resolve_address_async(raw_.get(), address.c_str(), static_cast<uint64_t>(timeout.count()),
+                                          request ? request->get() : nullptr, &Resolver::fulfill,
+                                          promise.get())) {
+            throw Error("bip353: invalid resolve arguments or no runtime worker threads");
+        }
+
+        // Ownership passes to the callback
+        promise.release();
+        return future;
+    }
+
+#ifdef BIP353_HAS_COROUTINES
+    /**
+     * Resolve an address from a coroutine: `Result r = co_await resolver.resolve_co(addr);`
+     *
+     * The coroutine resumes on a library worker thread.
+     */
+    ResolveAwaitable resolve_co(std::string address,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds(0),
+                                const Request* request = nullptr) const;
+#endif
+
+    ResolverPtr* get() const noexcept { return raw_.get(); }
+
+private:
+    explicit Resolver(ResolverPtr* raw) : raw_(raw) {
+        if (!raw_) {
+            throw Error("bip353: failed to create resolver");
+        }
+    }
+
+    static Result checked(Bip353Result* raw) {
+        if (!raw) {
+            throw Error("bip353: invalid resolve arguments");
+        }
+        return Result(raw);
+    }
+
+    static void fulfill(Bip353Result* raw, void* user_data) {
+        std::unique_ptr<std::promise<Result>> promise(static_cast<std::promise<Result>*>(user_data));
+        promise->set_value(Result(raw));
+    }
+
+    struct Deleter {
+        void operator()(ResolverPtr* raw) const noexcept { bip353_resolver_free(raw); }
+    };
+
+    std::unique_ptr<ResolverPtr, Deleter> raw_;
+};
+
+#ifdef BIP353_HAS_COROUTINES
+/**
+ * Awaitable for a single asynchronous resolution, built on
+ * bip353_resolve_address_async
+ */
+class ResolveAwaitable {
+public:
+    ResolveAwaitable(ResolverPtr* resolver, std::string address, uint64_t timeout_ms,
+                     const Bip353Request* request)
+        : resolver_(resolver), address_(std::move(address)), timeout_ms_(timeout_ms), request_(request) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        // The callback may resume the coroutine before this returns, so no
+        // member is touched after the call succeeds.
+        if (!bip353_resolve_address_async(resolver_, address_.c_str(), timeout_ms_, request_,
+                                          &ResolveAwaitable::complete, this)) {
+            started_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    Result await_resume() {
+        if (!started_) {
+            throw Error("bip353: invalid resolve arguments");
+        }
+        return std::move(result_);
+    }
+
+private:
+    static void complete(Bip353Result* raw, void* user_data) {
+        auto* self = static_cast<ResolveAwaitable*>(user_data);
+        self->result_ = Result(raw);
+        self->handle_.resume();
+    }
+
+    ResolverPtr* resolver_;
+    std::string address_;
+    uint64_t timeout_ms_;
+    const Bip353Request* request_;
+    std::coroutine_handle<> handle_;
+    Result result_;
+    bool started_ = true;
+};
+
+inline ResolveAwaitable Resolver::resolve_co(std::string address, std::chrono::milliseconds timeout,
+                                             const Request* request) const {
+    return ResolveAwaitable(raw_.get(), std::move(address), static_cast<uint64_t>(timeout.count()),
+                            request ? request->get() : nullptr);
+}
+#endif
+
+} // namespace bip353
+
+#endif /* BIP353_HPP */
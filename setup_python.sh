@@ -5,14 +5,14 @@ echo "🐍 Setting up Python bindings..."
 
 # Build the Python extension
 echo "Building Python extension..."
-cargo build --features python --release
+cargo build --features python,testing --release
 
 # Find the generated .so file
 RUST_SO=$(find target/release -name "*.so" -type f | head -1)
 
 if [ -z "$RUST_SO" ]; then
     echo "❌ No .so file found. Trying debug build..."
-    cargo build --features python
+    cargo build --features python,testing
     RUST_SO=$(find target/debug -name "*.so" -type f | head -1)
 fi
 
@@ -0,0 +1,330 @@
+//! Allocation profiling (`alloc-profile` feature)
+//!
+//! With the feature the crate exports `CountingAllocator`, which counts
+//! allocations and bytes per resolver stage, both per thread and
+//! process-wide, once a binary installs it as its global allocator. A stage
+//! is entered for the length of a synchronous section, or for every poll of
+//! an asynchronous one, so counts follow a resolution across runtime worker
+//! threads. Without the feature the stage hooks compile to nothing.
+
+use std::future::Future;
+
+#[cfg(feature = "alloc-profile")]
+use std::alloc::{GlobalAlloc, Layout, System};
+#[cfg(feature = "alloc-profile")]
+use std::cell::Cell;
+#[cfg(feature = "alloc-profile")]
+use std::sync::atomic::{AtomicU64, Ordering};
+
+/// Resolver stage that an allocation is attributed to
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AllocStage {
+    /// Outside any stage below: runtime, middleware and callers
+    Other,
+    /// Splitting the address and formatting the name
+    Parse,
+    /// Cache lookups, including the copy returned on a hit, and inserts
+    Cache,
+    /// Lookups and DNSSEC validation in the HRN resolver, and parsing the
+    /// payment instructions
+    Instructions,
+    /// Building the BIP-21 URI
+    Uri,
+    /// Building `PaymentInfo` from the instructions
+    PaymentInfo,
+    /// Converting results for C callers
+    Ffi,
+}
+
+const STAGES: usize = 7;
+
+impl AllocStage {
+    /// Every stage, in declaration order
+    pub const ALL: [AllocStage; STAGES] = [
+        AllocStage::Other,
+        AllocStage::Parse,
+        AllocStage::Cache,
+        AllocStage::Instructions,
+        AllocStage::Uri,
+        AllocStage::PaymentInfo,
+        AllocStage::Ffi,
+    ];
+    
+    pub fn as_str(self) -> &'static str {
+        match self {
+            AllocStage::Other => "other",
+            AllocStage::Parse => "parse",
+            AllocStage::Cache => "cache",
+            AllocStage::Instructions => "instructions",
+            AllocStage::Uri => "uri",
+            AllocStage::PaymentInfo => "payment_info",
+            AllocStage::Ffi => "ffi",
+        }
+    }
+}
+
+/// Allocations allowed for one `Bip353Resolver::resolve_address` answered
+/// from the cache, checked by the tests and `benches/allocations.rs`
+///
+/// Raise it only together with the change that needs the allocations.
+pub const CACHED_RESOLUTION_BUDGET: u64 = 8;
+
+/// Allocations allowed for one uncached resolution outside `AllocStage::Instructions`
+///
+/// Lookups and instruction parsing belong to bitcoin-payment-instructions
+/// and vary with its version, so they are reported but not budgeted. The
+/// URI stage has headroom for address types whose `Display` writes in parts.
+pub const UNCACHED_RESOLUTION_BUDGET: u64 = 16;
+
+/// Allocation count and bytes requested
+///
+/// A reallocation counts as one allocation of its new size.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct AllocCount {
+    pub allocations: u64,
+    pub bytes: u64,
+}
+
+/// Allocation counts per stage
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct AllocStats {
+    stages: [AllocCount; STAGES],
+}
+
+impl AllocStats {
+    pub fn get(&self, stage: AllocStage) -> AllocCount {
+        self.stages[stage as usize]
+    }
+    
+    /// Sum over every stage
+    pub fn total(&self) -> AllocCount {
+        self.stages.iter().fold(AllocCount::default(), |sum, count| AllocCount {
+            allocations: sum.allocations + count.allocations,
+            bytes: sum.bytes + count.bytes,
+        })
+    }
+    
+    /// Counts added since `earlier`, a snapshot of the same thread or process
+    pub fn since(&self, earlier: &AllocStats) -> AllocStats {
+        let mut stages = self.stages;
+        for (count, earlier) in stages.iter_mut().zip(&earlier.stages) {
+            count.allocations = count.allocations.saturating_sub(earlier.allocations);
+            count.bytes = count.bytes.saturating_sub(earlier.bytes);
+        }
+        AllocStats { stages }
+    }
+}
+
+/// Allocations made on the calling thread since it started
+#[cfg(feature = "alloc-profile")]
+pub fn thread_stats() -> AllocStats {
+    THREAD_COUNTS.with(|counts| AllocStats {
+        stages: std::array::from_fn(|i| counts[i].get()),
+    })
+}
+
+/// Allocations made by the whole process since it started
+#[cfg(feature = "alloc-profile")]
+pub fn process_stats() -> AllocStats {
+    AllocStats {
+        stages: std::array::from_fn(|i| AllocCount {
+            allocations: PROCESS_COUNTS[i][0].load(Ordering::Relaxed),
+            bytes: PROCESS_COUNTS[i][1].load(Ordering::Relaxed),
+        }),
+    }
+}
+
+#[cfg(feature = "alloc-profile")]
+const ZERO: Cell<AllocCount> = Cell::new(AllocCount { allocations: 0, bytes: 0 });
+#[cfg(feature = "alloc-profile")]
+const ZERO_ATOMIC: [AtomicU64; 2] = [AtomicU64::new(0), AtomicU64::new(0)];
+
+#[cfg(feature = "alloc-profile")]
+thread_local! {
+    static STAGE: Cell<AllocStage> = const { Cell::new(AllocStage::Other) };
+    static THREAD_COUNTS: [Cell<AllocCount>; STAGES] = const { [ZERO; STAGES] };
+}
+
+#[cfg(feature = "alloc-profile")]
+static PROCESS_COUNTS: [[AtomicU64; 2]; STAGES] = [ZERO_ATOMIC; STAGES];
+
+/// Global allocator that counts allocations per stage, then defers to `System`
+///
+/// The library does not install it; a binary or test that wants counts does:
+///
+/// ```ignore
+/// #[global_allocator]
+/// static ALLOCATOR: bip353::CountingAllocator = bip353::CountingAllocator;
+/// ```
+#[cfg(feature = "alloc-profile")]
+pub struct CountingAllocator;
+
+#[cfg(feature = "alloc-profile")]
+impl CountingAllocator {
+    #[inline]
+    fn count(size: usize) {
+        // Thread-locals without destructors stay readable while a thread exits
+        let stage = STAGE.try_with(Cell::get).unwrap_or(AllocStage::Other);
+        let _ = THREAD_COUNTS.try_with(|counts| {
+            let count = &counts[stage as usize];
+            let AllocCount { allocations, bytes } = count.get();
+            count.set(AllocCount { allocations: allocations + 1, bytes: bytes + size as u64 });
+        });
+        PROCESS_COUNTS[stage as usize][0].fetch_add(1, Ordering::Relaxed);
+        PROCESS_COUNTS[stage as usize][1].fetch_add(size as u64, Ordering::Relaxed);
+    }
+}
+
+#[cfg(feature = "alloc-profile")]
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        Self::count(layout.size());
+        System.alloc(layout)
+    }
+    
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        Self::count(layout.size());
+        System.alloc_zeroed(layout)
+    }
+    
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        Self::count(new_size);
+        System.realloc(ptr, layout, new_size)
+    }
+    
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+}
+
+/// Attributes allocations on this thread to a stage until dropped
+pub(crate) struct StageGuard {
+    #[cfg(feature = "alloc-profile")]
+    previous: AllocStage,
+}
+
+/// Enter `stage` on this thread; the previous stage is restored on drop
+#[inline]
+pub(crate) fn enter(stage: AllocStage) -> StageGuard {
+    #[cfg(feature = "alloc-profile")]
+    return StageGuard {
+        previous: STAGE.with(|current| current.replace(stage)),
+    };
+    
+    #[cfg(not(feature = "alloc-profile"))]
+    {
+        let _ = stage;
+        StageGuard {}
+    }
+}
+
+#[cfg(feature = "alloc-profile")]
+impl Drop for StageGuard {
+    fn drop(&mut self) {
+        STAGE.with(|current| current.set(self.previous));
+    }
+}
+
+/// Attribute the allocations made while polling `future` to `stage`
+pub(crate) fn staged<F: Future>(stage: AllocStage, future: F) -> impl Future<Output = F::Output> {
+    #[cfg(feature = "alloc-profile")]
+    return async move {
+        let mut future = std::pin::pin!(future);
+        std::future::poll_fn(|cx| {
+            let _stage = enter(stage);
+            future.as_mut().poll(cx)
+        }).await
+    };
+    
+    #[cfg(not(feature = "alloc-profile"))]
+    {
+        let _ = stage;
+        future
+    }
+}
+
+#[cfg(all(test, feature = "alloc-profile"))]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+    
+    use bitcoin_payment_instructions::amount::Amount;
+    use bitcoin_payment_instructions::hrn_resolution::{
+        HrnResolution,
+        HrnResolutionFuture,
+        HrnResolver,
+        HumanReadableName,
+        LNURLResolutionFuture,
+    };
+    
+    use crate::{Bip353Resolver, ResolverConfig};
+    
+    // The library leaves the global allocator alone; the test binary counts
+    #[global_allocator]
+    static ALLOCATOR: CountingAllocator = CountingAllocator;
+    
+    /// HRN resolver that answers every name with the same on-chain address
+    struct StaticResolver;
+    
+    impl HrnResolver for StaticResolver {
+        fn resolve_hrn<'a>(&'a self, _hrn: &'a HumanReadableName) -> HrnResolutionFuture<'a> {
+            Box::pin(async {
+                Ok(HrnResolution::DNSSEC {
+                    proof: None,
+                    result: "bitcoin:bc1qar0srrr7xfkvy5l643lydnw9re59gtzzwf5mdq".to_string(),
+                })
+            })
+        }
+        
+        fn resolve_lnurl<'a>(&'a self, _url: &'a str) -> HrnResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+        
+        fn resolve_lnurl_to_invoice<'a>(&'a self, _: String, _: Amount, _: [u8; 32]) -> LNURLResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+    }
+    
+    #[test]
+    fn test_stage_attribution() {
+        let before = thread_stats();
+        {
+            let _stage = enter(AllocStage::Uri);
+            drop(std::hint::black_box(vec![0u8; 100]));
+        }
+        drop(std::hint::black_box(vec![0u8; 10]));
+        
+        let stats = thread_stats().since(&before);
+        assert_eq!(stats.get(AllocStage::Uri), AllocCount { allocations: 1, bytes: 100 });
+        assert_eq!(stats.get(AllocStage::Other), AllocCount { allocations: 1, bytes: 10 });
+    }
+    
+    #[tokio::test]
+    async fn test_resolution_allocation_budgets() {
+        let config = ResolverConfig::default().with_cache_ttl(Duration::from_secs(60));
+        let resolver = Bip353Resolver::with_hrn_resolver(StaticResolver, config);
+        
+        // The test runtime is single-threaded, so every allocation lands on this thread
+        let before = thread_stats();
+        resolver.resolve_address("alice@example.com").await.unwrap();
+        let uncached = thread_stats().since(&before);
+        
+        let before = thread_stats();
+        resolver.resolve_address("alice@example.com").await.unwrap();
+        let cached = thread_stats().since(&before);
+        
+        let outside_instructions = uncached.total().allocations - uncached.get(AllocStage::Instructions).allocations;
+        assert!(
+            outside_instructions <= UNCACHED_RESOLUTION_BUDGET,
+            "uncached resolution made {} allocations outside instruction parsing, budget {}: {:?}",
+            outside_instructions, UNCACHED_RESOLUTION_BUDGET, uncached,
+        );
+        assert!(
+            cached.total().allocations <= CACHED_RESOLUTION_BUDGET,
+            "cached resolution made {} allocations, budget {}: {:?}",
+            cached.total().allocations, CACHED_RESOLUTION_BUDGET, cached,
+        );
+        assert_eq!(cached.get(AllocStage::Instructions).allocations, 0);
+        assert!(cached.get(AllocStage::Cache).allocations > 0);
+    }
+}
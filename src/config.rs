@@ -21,6 +21,92 @@ pub struct ResolverConfig {
     
     /// Network to use for parsing payment instructions
     pub network: bitcoin::Network,
+    
+    /// Maximum number of entries kept in the address cache (0 = unbounded)
+    pub cache_max_entries: usize,
+    
+    /// Middleware layers wrapped around each resolution
+    pub layers: LayerConfig,
+    
+    /// Keep the most recent resolutions in a flight recorder
+    pub flight_recorder: Option<FlightRecorderConfig>,
+}
+
+/// Middleware layers applied to every resolution, all disabled by default
+///
+/// From the outside in: cache, metrics, single-flight, retry, rate limit,
+/// timeout. A disabled layer costs one branch per resolution.
+#[derive(Debug, Clone, Default)]
+pub struct LayerConfig {
+    /// Cache successful resolutions for this long
+    pub cache_ttl: Option<Duration>,
+    
+    /// Record resolution metrics
+    pub metrics: bool,
+    
+    /// Share one in-flight lookup between concurrent requests for the same name
+    pub single_flight: bool,
+    
+    /// Retry transient failures
+    pub retry: Option<RetryPolicy>,
+    
+    /// Limit the rate of lookups reaching the network
+    pub rate_limit: Option<RateLimit>,
+    
+    /// Abort each lookup attempt after `ResolverConfig::timeout_ms`
+    pub timeout: bool,
+}
+
+/// Retry policy for transient failures (DNS, network, timeout, rate limit)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct RetryPolicy {
+    /// Retries after the first attempt
+    pub max_retries: u32,
+    
+    /// Delay before the first retry, doubled for each further retry
+    pub backoff: Duration,
+}
+
+impl Default for RetryPolicy {
+    fn default() -> Self {
+        Self {
+            max_retries: 2,
+            backoff: Duration::from_millis(100),
+        }
+    }
+}
+
+/// Token-bucket rate limit
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct RateLimit {
+    /// Sustained lookups per second
+    pub per_second: u32,
+    
+    /// Lookups allowed in a burst
+    pub burst: u32,
+}
+
+/// Flight recorder sizing and slow-query threshold
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct FlightRecorderConfig {
+    /// Most recent resolutions kept
+    pub capacity: usize,
+    
+    /// Slow resolutions kept apart, so fast traffic cannot overwrite them
+    pub pinned_capacity: usize,
+    
+    /// Resolutions taking at least this long are pinned
+    pub slow_threshold: Duration,
+}
+
+impl Default for FlightRecorderConfig {
+    fn default() -> Self {
+        Self {
+            capacity: 1024,
+            pinned_capacity: 128,
+            slow_threshold: Duration::from_secs(1),
+        }
+    }
 }
 
 impl Default for ResolverConfig {
@@ -32,6 +118,9 @@ impl Default for ResolverConfig {
             timeout_ms: 5000, // 5 second timeout
             allow_http_fallback: true,
             network: bitcoin::Network::Bitcoin,
+            cache_max_entries: 0,
+            layers: LayerConfig::default(),
+            flight_recorder: None,
         }
     }
 }
@@ -91,6 +180,54 @@ impl ResolverConfig {
         self
     }
     
+    /// Set the maximum number of cached entries (0 = unbounded)
+    pub fn with_cache_capacity(mut self, max_entries: usize) -> Self {
+        self.cache_max_entries = max_entries;
+        self
+    }
+    
+    /// Enable the cache layer with the given entry lifetime
+    pub fn with_cache_ttl(mut self, ttl: Duration) -> Self {
+        self.layers.cache_ttl = Some(ttl);
+        self
+    }
+    
+    /// Enable or disable the metrics layer
+    pub fn with_metrics(mut self, enable: bool) -> Self {
+        self.layers.metrics = enable;
+        self
+    }
+    
+    /// Enable or disable single-flight request coalescing
+    pub fn with_single_flight(mut self, enable: bool) -> Self {
+        self.layers.single_flight = enable;
+        self
+    }
+    
+    /// Enable the retry layer
+    pub fn with_retry(mut self, policy: RetryPolicy) -> Self {
+        self.layers.retry = Some(policy);
+        self
+    }
+    
+    /// Enable the rate limit layer
+    pub fn with_rate_limit(mut self, limit: RateLimit) -> Self {
+        self.layers.rate_limit = Some(limit);
+        self
+    }
+    
+    /// Enable or disable enforcement of the timeout on each lookup
+    pub fn with_enforced_timeout(mut self, enable: bool) -> Self {
+        self.layers.timeout = enable;
+        self
+    }
+    
+    /// Record recent resolutions in a flight recorder
+    pub fn with_flight_recorder(mut self, config: FlightRecorderConfig) -> Self {
+        self.flight_recorder = Some(config);
+        self
+    }
+    
     /// Get the timeout as a Duration
     pub fn timeout(&self) -> Duration {
         Duration::from_millis(self.timeout_ms)
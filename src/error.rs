@@ -3,7 +3,7 @@
 use thiserror::Error;
 
 /// Main error type for BIP-353 operations
-#[derive(Error, Debug)]
+#[derive(Error, Debug, Clone)]
 pub enum Bip353Error {
     /// DNS resolution or DNSSEC validation error
     #[error("DNS error: {0}")]
@@ -28,6 +28,84 @@ pub enum Bip353Error {
     /// Network or I/O error
     #[error("Network error: {0}")]
     NetworkError(String),
+
+    /// Resolution did not complete before its deadline
+    #[error("Timeout: {0}")]
+    Timeout(String),
+
+    /// Resolution was cancelled by the caller
+    #[error("Cancelled")]
+    Cancelled,
+
+    /// Lookup rejected by the resolver's rate limit
+    #[error("Rate limit exceeded")]
+    RateLimited,
+}
+
+/// Kind of a `Bip353Error`, without its message
+///
+/// The discriminants are stable: USDT probes and flight records report a
+/// failure as the kind plus one, and the `bpftrace/` scripts decode it.
+/// Add new kinds at the end.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+#[repr(u8)]
+pub enum ErrorKind {
+    Dns = 0,
+    InvalidAddress = 1,
+    InvalidRecord = 2,
+    Dnssec = 3,
+    Impl = 4,
+    Network = 5,
+    Timeout = 6,
+    Cancelled = 7,
+    RateLimited = 8,
+}
+
+impl ErrorKind {
+    /// Every kind, in declaration order
+    pub const ALL: [ErrorKind; 9] = [
+        ErrorKind::Dns,
+        ErrorKind::InvalidAddress,
+        ErrorKind::InvalidRecord,
+        ErrorKind::Dnssec,
+        ErrorKind::Impl,
+        ErrorKind::Network,
+        ErrorKind::Timeout,
+        ErrorKind::Cancelled,
+        ErrorKind::RateLimited,
+    ];
+    
+    /// Stable lowercase name, for metric labels
+    pub fn as_str(&self) -> &'static str {
+        match self {
+            ErrorKind::Dns => "dns",
+            ErrorKind::InvalidAddress => "invalid_address",
+            ErrorKind::InvalidRecord => "invalid_record",
+            ErrorKind::Dnssec => "dnssec",
+            ErrorKind::Impl => "impl",
+            ErrorKind::Network => "network",
+            ErrorKind::Timeout => "timeout",
+            ErrorKind::Cancelled => "cancelled",
+            ErrorKind::RateLimited => "rate_limited",
+        }
+    }
+}
+
+impl Bip353Error {
+    /// The kind of this error
+    pub fn kind(&self) -> ErrorKind {
+        match self {
+            Bip353Error::DnsError(_) => ErrorKind::Dns,
+            Bip353Error::InvalidAddress(_) => ErrorKind::InvalidAddress,
+            Bip353Error::InvalidRecord(_) => ErrorKind::InvalidRecord,
+            Bip353Error::DnssecError(_) => ErrorKind::Dnssec,
+            Bip353Error::ImplError(_) => ErrorKind::Impl,
+            Bip353Error::NetworkError(_) => ErrorKind::Network,
+            Bip353Error::Timeout(_) => ErrorKind::Timeout,
+            Bip353Error::Cancelled => ErrorKind::Cancelled,
+            Bip353Error::RateLimited => ErrorKind::RateLimited,
+        }
+    }
 }
 
 impl From<bitcoin_payment_instructions::ParseError> for Bip353Error {
@@ -80,4 +158,19 @@ impl Bip353Error {
     pub(crate) fn to_string_representation(&self) -> String {
         self.to_string()
     }
-}
\ No newline at end of file
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    
+    #[test]
+    fn test_kind_status_is_stable() {
+        // Probe and flight recorder statuses, as decoded by bpftrace/*.bt
+        for (i, kind) in ErrorKind::ALL.iter().enumerate() {
+            assert_eq!(*kind as usize, i);
+        }
+        assert_eq!(crate::usdt::status::<()>(&Err(Bip353Error::DnsError("".into()))), 1);
+        assert_eq!(crate::usdt::status::<()>(&Err(Bip353Error::RateLimited)), 9);
+    }
+}
@@ -0,0 +1,165 @@
+//! OpenMetrics text exposition of resolver metrics
+//!
+//! Rendering only reads relaxed atomics and copies the tracked-domain table
+//! under its lock, so a scrape never blocks resolutions for longer than that
+//! copy.
+
+use std::fmt::Write;
+use std::time::Duration;
+
+use crate::metrics::{Bip353Metrics, LatencySummary};
+
+/// Content type of the rendered text, for HTTP responses
+pub const OPENMETRICS_CONTENT_TYPE: &str =
+    "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+/// Render `metrics` in OpenMetrics text format, terminated by `# EOF`
+pub fn render_openmetrics(metrics: &Bip353Metrics) -> String {
+    let mut out = String::with_capacity(4096);
+    write_metrics(&mut out, metrics);
+    out.push_str("# EOF\n");
+    out
+}
+
+/// Append every metric family of `metrics` to `out`, without the `# EOF` line
+pub(crate) fn write_metrics(out: &mut String, metrics: &Bip353Metrics) {
+    let resolutions = metrics.get_resolution_stats();
+    family(out, "bip353_resolutions", "counter", "Resolutions by result");
+    sample(out, "bip353_resolutions_total", &[("result", "success")], resolutions.success);
+    sample(out, "bip353_resolutions_total", &[("result", "failure")], resolutions.failed);
+    
+    family(out, "bip353_resolution_failures", "counter", "Failed resolutions by error kind");
+    for (kind, count) in metrics.get_failure_stats().counts {
+        sample(out, "bip353_resolution_failures_total", &[("kind", kind.as_str())], count);
+    }
+    
+    let cache = metrics.get_cache_stats();
+    family(out, "bip353_cache_lookups", "counter", "Address cache lookups by result");
+    sample(out, "bip353_cache_lookups_total", &[("result", "hit")], cache.hits);
+    sample(out, "bip353_cache_lookups_total", &[("result", "miss")], cache.misses);
+    
+    family(out, "bip353_address_reuse_detected", "counter", "Resolved addresses seen in use on chain");
+    sample(out, "bip353_address_reuse_detected_total", &[], metrics.get_address_reuse_count());
+    
+    let latency = metrics.get_latency_stats();
+    family(out, "bip353_resolution_duration_seconds", "summary", "Resolution latency by outcome");
+    out.push_str("# UNIT bip353_resolution_duration_seconds seconds\n");
+    for (outcome, summary) in [
+        ("cache_hit", &latency.cache_hit),
+        ("cache_miss", &latency.cache_miss),
+        ("error", &latency.error),
+    ] {
+        write_summary(out, "bip353_resolution_duration_seconds", outcome, summary);
+    }
+    
+    // Lookups below the cache, i.e. those that reached the upstream resolver
+    let domains = metrics.top_domains(usize::MAX);
+    family(out, "bip353_upstream_domain_lookups", "gauge", "Upstream lookups of the most queried domains");
+    for d in &domains {
+        sample(out, "bip353_upstream_domain_lookups", &[("domain", &d.domain)], d.lookups);
+    }
+    family(out, "bip353_upstream_domain_failures", "gauge", "Upstream failures since the domain was tracked");
+    for d in &domains {
+        sample(out, "bip353_upstream_domain_failures", &[("domain", &d.domain)], d.failures);
+    }
+    family(out, "bip353_upstream_domain_latency_seconds", "gauge", "Mean upstream latency of successful lookups");
+    out.push_str("# UNIT bip353_upstream_domain_latency_seconds seconds\n");
+    for d in &domains {
+        sample(out, "bip353_upstream_domain_latency_seconds", &[("domain", &d.domain)], Seconds(d.mean_latency));
+    }
+    family(out, "bip353_domain_samples_dropped", "counter", "Lookups left out of the per-domain gauges under contention");
+    sample(out, "bip353_domain_samples_dropped_total", &[], metrics.get_dropped_domain_samples());
+}
+
+/// Append the metadata lines of one metric family
+pub(crate) fn family(out: &mut String, name: &str, kind: &str, help: &str) {
+    let _ = writeln!(out, "# TYPE {} {}", name, kind);
+    let _ = writeln!(out, "# HELP {} {}", name, help);
+}
+
+/// Append one sample line
+pub(crate) fn sample(out: &mut String, name: &str, labels: &[(&str, &str)], value: impl std::fmt::Display) {
+    out.push_str(name);
+    if !labels.is_empty() {
+        out.push('{');
+        for (i, (label, value)) in labels.iter().enumerate() {
+            if i > 0 {
+                out.push(',');
+            }
+            out.push_str(label);
+            out.push_str("=\"");
+            escape_label(out, value);
+            out.push('"');
+        }
+        out.push('}');
+    }
+    let _ = writeln!(out, " {}", value);
+}
+
+fn write_summary(out: &mut String, name: &str, outcome: &str, summary: &LatencySummary) {
+    for (quantile, value) in [
+        ("0.5", summary.p50),
+        ("0.9", summary.p90),
+        ("0.99", summary.p99),
+        ("0.999", summary.p999),
+    ] {
+        sample(out, name, &[("outcome", outcome), ("quantile", quantile)], Seconds(value));
+    }
+    sample(out, &format!("{}_sum", name), &[("outcome", outcome)], Seconds(summary.sum));
+    sample(out, &format!("{}_count", name), &[("outcome", outcome)], summary.count);
+}
+
+/// Escape a label value: backslash, double quote and newline
+fn escape_label(out: &mut String, value: &str) {
+    for c in value.chars() {
+        match c {
+            '\\' => out.push_str("\\\\"),
+            '"' => out.push_str("\\\""),
+            '\n' => out.push_str("\\n"),
+            c => out.push(c),
+        }
+    }
+}
+
+/// Duration formatted as fractional seconds
+struct Seconds(Duration);
+
+impl std::fmt::Display for Seconds {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(f, "{}", self.0.as_secs_f64())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::error::ErrorKind;
+    
+    #[test]
+    fn test_render_openmetrics() {
+        let metrics = Bip353Metrics::new();
+        metrics.record_cache_miss();
+        metrics.record_resolution_success("example.com", Duration::from_millis(20));
+        metrics.record_resolution_failure("bad\"domain", ErrorKind::Dns);
+        
+        let text = render_openmetrics(&metrics);
+        assert!(text.ends_with("# EOF\n"));
+        assert!(text.contains("bip353_resolutions_total{result=\"success\"} 1\n"));
+        assert!(text.contains("bip353_resolution_failures_total{kind=\"dns\"} 1\n"));
+        assert!(text.contains("bip353_cache_lookups_total{result=\"miss\"} 1\n"));
+        assert!(text.contains("bip353_resolution_duration_seconds_count{outcome=\"cache_miss\"} 1\n"));
+        assert!(text.contains("bip353_upstream_domain_lookups{domain=\"example.com\"} 1\n"));
+        assert!(text.contains("bip353_upstream_domain_failures{domain=\"bad\\\"domain\"} 1\n"));
+        assert!(text.contains("bip353_domain_samples_dropped_total 0\n"));
+        
+        // Every sample belongs to the family declared before it
+        let mut family = "";
+        for line in text.lines() {
+            if let Some(rest) = line.strip_prefix("# TYPE ") {
+                family = rest.split(' ').next().unwrap();
+            } else if !line.starts_with('#') {
+                assert!(line.starts_with(family), "{} outside {}", line, family);
+            }
+        }
+    }
+}
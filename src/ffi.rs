@@ -2,31 +2,186 @@
 //!
 //! These bindings provide a C API for integration with Bitcoin Core.
 
-use std::ffi::{c_char, CStr, CString};
+use std::borrow::Cow;
+use std::ffi::{c_char, c_int, c_void, CStr, CString};
+use std::mem;
+use std::net::SocketAddr;
 use std::ptr;
-use std::sync::Arc;
-use once_cell::sync::OnceCell;
-use tokio::runtime::Runtime;
+use std::slice;
+use std::sync::{Arc, Mutex, PoisonError, RwLock};
+use std::thread;
+use std::time::{Duration, Instant};
+use futures::future::{AbortHandle, AbortRegistration, Abortable};
+use tokio::runtime::{Handle, Runtime, RuntimeFlavor};
 
+use crate::alloc_profile::{self, AllocStage};
+use crate::runtime::{build_runtime, DEFAULT_THREAD_NAME_PREFIX, DEFAULT_WORKER_THREADS};
+use crate::usdt;
 use crate::{
     Bip353Error,
     Bip353Resolver,
+    CacheStatus,
+    FlightRecorderConfig,
     ResolverConfig,
     PaymentInfo,
+    PaymentType,
+    RateLimit,
+    ResolutionReport,
+    RetryPolicy,
 };
 
-// Global runtime for async operations
-static RUNTIME: OnceCell<Runtime> = OnceCell::new();
+// Global runtime for async operations, created by bip353_init or on first use.
+// Every call holds a clone of the Arc while it runs so that bip353_shutdown
+// can wait for in-flight requests before joining the worker threads.
+static RUNTIME: RwLock<Option<Arc<Runtime>>> = RwLock::new(None);
 
-fn get_runtime() -> &'static Runtime {
-    RUNTIME.get_or_init(|| {
-        Runtime::new().expect("Failed to create Tokio runtime")
-    })
+fn get_runtime() -> Arc<Runtime> {
+    if let Some(runtime) = RUNTIME.read().unwrap_or_else(PoisonError::into_inner).as_ref() {
+        return runtime.clone();
+    }
+    
+    let mut slot = RUNTIME.write().unwrap_or_else(PoisonError::into_inner);
+    slot.get_or_insert_with(|| {
+        let runtime = build_runtime(DEFAULT_WORKER_THREADS, DEFAULT_THREAD_NAME_PREFIX, false)
+            .expect("Failed to create Tokio runtime");
+        Arc::new(runtime)
+    }).clone()
+}
+
+/// The global runtime, if it has worker threads to run spawned tasks
+///
+/// A current-thread runtime only makes progress inside `block_on`, so a task
+/// spawned for a C caller that then returns would never run.
+fn get_spawn_runtime() -> Option<Arc<Runtime>> {
+    let runtime = get_runtime();
+    (runtime.handle().runtime_flavor() != RuntimeFlavor::CurrentThread).then_some(runtime)
+}
+
+/// The global runtime, unless the caller is already on a runtime thread
+///
+/// `block_on` panics there, which would abort the C caller; this happens when
+/// a blocking call is made from a `bip353_resolve_address_async` callback.
+fn get_blocking_runtime() -> Result<Arc<Runtime>, Bip353Error> {
+    if on_runtime_thread() {
+        return Err(Bip353Error::ImplError("Blocking call from a runtime thread".into()));
+    }
+    Ok(get_runtime())
+}
+
+fn on_runtime_thread() -> bool {
+    Handle::try_current().is_ok()
+}
+
+/// Initialize the global runtime
+///
+/// Must be called before any resolution to take effect. Returns 1 on success,
+/// or 0 if the runtime is already running or cannot be created.
+#[no_mangle]
+pub extern "C" fn bip353_init(
+    worker_threads: u32,
+    thread_name_prefix: *const c_char,
+    current_thread: c_int,
+) -> c_int {
+    let prefix = if thread_name_prefix.is_null() {
+        DEFAULT_THREAD_NAME_PREFIX
+    } else {
+        match unsafe { CStr::from_ptr(thread_name_prefix) }.to_str() {
+            Ok(s) => s,
+            Err(_) => return 0,
+        }
+    };
+    
+    let worker_threads = if worker_threads == 0 {
+        DEFAULT_WORKER_THREADS
+    } else {
+        worker_threads as usize
+    };
+    
+    let mut slot = RUNTIME.write().unwrap_or_else(PoisonError::into_inner);
+    if slot.is_some() {
+        return 0;
+    }
+    
+    match build_runtime(worker_threads, prefix, current_thread != 0) {
+        Ok(runtime) => {
+            *slot = Some(Arc::new(runtime));
+            1
+        }
+        Err(_) => 0,
+    }
+}
+
+/// Shut down the global runtime
+///
+/// Waits up to `timeout_ms` (0 = no limit) for in-flight requests to finish,
+/// then stops and joins the worker threads. Returns 0 if requests were
+/// still running when the timeout expired; the runtime is then torn down in
+/// the background once they finish. A later call re-creates the runtime on
+/// demand.
+///
+/// Returns -1 without doing anything when called from a runtime thread, such
+/// as an async callback, whose own task would keep the runtime alive.
+#[no_mangle]
+pub extern "C" fn bip353_shutdown(timeout_ms: u64) -> c_int {
+    if on_runtime_thread() {
+        return -1;
+    }
+    
+    let runtime = RUNTIME.write().unwrap_or_else(PoisonError::into_inner).take();
+    let mut runtime = match runtime {
+        Some(runtime) => runtime,
+        None => return 1,
+    };
+    
+    let deadline = (timeout_ms > 0).then(|| Instant::now() + Duration::from_millis(timeout_ms));
+    loop {
+        match Arc::try_unwrap(runtime) {
+            Ok(runtime) => {
+                // Dropping the runtime joins its worker threads
+                drop(runtime);
+                return 1;
+            }
+            Err(shared) => {
+                if deadline.map_or(false, |deadline| Instant::now() >= deadline) {
+                    // Keep the last reference off the worker threads: a runtime
+                    // cannot be dropped from inside one of its own tasks.
+                    thread::spawn(move || {
+                        drop_when_idle(shared);
+                    });
+                    return 0;
+                }
+                runtime = shared;
+                thread::sleep(Duration::from_millis(1));
+            }
+        }
+    }
+}
+
+/// Wait until `runtime` is the only reference left, then drop it
+fn drop_when_idle(mut runtime: Arc<Runtime>) {
+    loop {
+        match Arc::try_unwrap(runtime) {
+            Ok(runtime) => return drop(runtime),
+            Err(shared) => {
+                runtime = shared;
+                thread::sleep(Duration::from_millis(1));
+            }
+        }
+    }
 }
 
 /// Opaque pointer for the resolver
 pub struct ResolverPtr(Arc<Bip353Resolver>);
 
+impl ResolverPtr {
+    /// Hand a resolver built in Rust, such as one with a custom transport, to C callers
+    ///
+    /// Free the returned pointer with `bip353_resolver_free`.
+    pub fn into_raw(resolver: Bip353Resolver) -> *mut ResolverPtr {
+        Box::into_raw(Box::new(ResolverPtr(Arc::new(resolver))))
+    }
+}
+
 /// Create a new resolver with default configuration
 #[no_mangle]
 pub extern "C" fn bip353_resolver_create() -> *mut ResolverPtr {
@@ -52,12 +207,9 @@ pub extern "C" fn bip353_resolver_create_with_network(network_name: *const c_cha
         Err(_) => return ptr::null_mut(),
     };
     
-    let config = match network_str {
-        "main" | "mainnet" | "bitcoin" => ResolverConfig::default(),
-        "test" | "testnet" => ResolverConfig::testnet(),
-        "signet" => ResolverConfig::signet(),
-        "regtest" => ResolverConfig::regtest(),
-        _ => return ptr::null_mut(),
+    let config = match network_config(network_str) {
+        Some(config) => config,
+        None => return ptr::null_mut(),
     };
     
     match Bip353Resolver::with_config(config) {
@@ -70,6 +222,285 @@ pub extern "C" fn bip353_resolver_create_with_network(network_name: *const c_cha
     }
 }
 
+/// Map a network name to its base configuration
+fn network_config(network_name: &str) -> Option<ResolverConfig> {
+    match network_name {
+        "main" | "mainnet" | "bitcoin" => Some(ResolverConfig::default()),
+        "test" | "testnet" => Some(ResolverConfig::testnet()),
+        "signet" => Some(ResolverConfig::signet()),
+        "regtest" => Some(ResolverConfig::regtest()),
+        _ => None,
+    }
+}
+
+/// Current version of the `Bip353Config` layout
+pub const BIP353_CONFIG_VERSION: u32 = 1;
+
+/// Resolver configuration passed from C
+///
+/// The struct is size-prefixed: callers set `struct_size` to the
+/// `sizeof(Bip353Config)` they were compiled against, and any field beyond
+/// that size keeps its default. New fields are only ever appended, so a
+/// larger struct is accepted when the fields past this layout are zero.
+#[repr(C)]
+pub struct Bip353Config {
+    /// Size of the struct as seen by the caller
+    pub struct_size: u32,
+    
+    /// Layout version (`BIP353_CONFIG_VERSION`)
+    pub version: u32,
+    
+    /// Network name ("main", "testnet", "signet" or "regtest"), NULL for mainnet
+    pub network: *const c_char,
+    
+    /// DNS resolver as "ip:port", NULL for the default
+    pub dns_resolver: *const c_char,
+    
+    /// Deadline for each lookup attempt in milliseconds, applied only with
+    /// `enforce_timeout`; also the default deadline of the deadline-taking calls
+    pub timeout_ms: u64,
+    
+    /// Reserved: DNSSEC is always validated, so this must stay 1
+    pub enforce_dnssec: c_int,
+    
+    /// Reserved: there is no HTTP fallback yet, so this must stay 0
+    pub allow_http_fallback: c_int,
+    
+    /// Whether to cache resolved addresses
+    pub enable_cache: c_int,
+    
+    /// Whether to collect metrics
+    pub enable_metrics: c_int,
+    
+    /// Cache entry lifetime in seconds
+    pub cache_ttl_secs: u64,
+    
+    /// Maximum number of cached entries (0 = unbounded)
+    pub cache_max_entries: u64,
+    
+    /// Whether concurrent lookups of the same name share one query
+    pub single_flight: c_int,
+    
+    /// Whether `timeout_ms` is enforced on each lookup attempt
+    pub enforce_timeout: c_int,
+    
+    /// Retries for transient failures (0 = no retry layer)
+    pub max_retries: u32,
+    
+    /// Lookups per second reaching the network (0 = unlimited)
+    pub rate_limit_per_sec: u32,
+    
+    /// Recent resolutions kept by the flight recorder (0 = disabled)
+    pub flight_recorder_capacity: u32,
+    
+    /// Resolutions at least this slow are pinned in the flight recorder
+    pub slow_query_ms: u32,
+}
+
+impl Default for Bip353Config {
+    fn default() -> Self {
+        let defaults = ResolverConfig::default();
+        Self {
+            struct_size: mem::size_of::<Bip353Config>() as u32,
+            version: BIP353_CONFIG_VERSION,
+            network: ptr::null(),
+            dns_resolver: ptr::null(),
+            timeout_ms: defaults.timeout_ms,
+            enforce_dnssec: defaults.enforce_dnssec as c_int,
+            allow_http_fallback: 0,
+            enable_cache: 0,
+            enable_metrics: 0,
+            cache_ttl_secs: 300,
+            cache_max_entries: defaults.cache_max_entries as u64,
+            single_flight: 0,
+            enforce_timeout: 0,
+            max_retries: 0,
+            rate_limit_per_sec: 0,
+            flight_recorder_capacity: 0,
+            slow_query_ms: FlightRecorderConfig::default().slow_threshold.as_millis() as u32,
+        }
+    }
+}
+
+/// `struct_size` of a caller that only sets the size and version header
+const CONFIG_HEADER_SIZE: usize = mem::offset_of!(Bip353Config, network);
+
+/// Copy a caller-provided config, filling fields the caller doesn't know about with defaults
+///
+/// A caller compiled against a newer header may pass a larger struct as long
+/// as every field this library doesn't know about is zero. Returns None for
+/// any other `struct_size` than the header alone or the current layout.
+unsafe fn read_config(config: *const Bip353Config) -> Option<Bip353Config> {
+    // The size and version header is present in every layout
+    let caller_size = (*config).struct_size as usize;
+    let known_size = mem::size_of::<Bip353Config>();
+    if (*config).version == 0 {
+        return None;
+    }
+    if caller_size > known_size {
+        let newer_fields = slice::from_raw_parts((config as *const u8).add(known_size), caller_size - known_size);
+        if newer_fields.iter().any(|&byte| byte != 0) {
+            return None;
+        }
+    } else if caller_size != CONFIG_HEADER_SIZE && caller_size != known_size {
+        return None;
+    }
+    
+    let mut result = Bip353Config::default();
+    ptr::copy_nonoverlapping(
+        config as *const u8,
+        &mut result as *mut Bip353Config as *mut u8,
+        caller_size.min(known_size),
+    );
+    result.struct_size = known_size as u32;
+    
+    Some(result)
+}
+
+/// Initialize a config with default values
+#[no_mangle]
+pub extern "C" fn bip353_config_init(config: *mut Bip353Config) {
+    if !config.is_null() {
+        unsafe {
+            ptr::write(config, Bip353Config::default());
+        }
+    }
+}
+
+/// Create a new resolver from a full configuration
+#[no_mangle]
+pub extern "C" fn bip353_resolver_create_with_config(config: *const Bip353Config) -> *mut ResolverPtr {
+    if config.is_null() {
+        return ptr::null_mut();
+    }
+    
+    match unsafe { read_config(config) }.as_ref().and_then(resolver_config) {
+        Some(resolver_config) => match Bip353Resolver::with_config(resolver_config) {
+            Ok(resolver) => ResolverPtr::into_raw(resolver),
+            Err(_) => ptr::null_mut(),
+        },
+        None => ptr::null_mut(),
+    }
+}
+
+/// Translate a C config into a resolver configuration, None if it is invalid
+fn resolver_config(config: &Bip353Config) -> Option<ResolverConfig> {
+    // Refuse the reserved fields rather than silently ignore them
+    if config.enforce_dnssec == 0 || config.allow_http_fallback != 0 {
+        return None;
+    }
+    
+    let mut resolver_config = if config.network.is_null() {
+        ResolverConfig::default()
+    } else {
+        let network_str = unsafe { CStr::from_ptr(config.network) }.to_str().ok()?;
+        network_config(network_str)?
+    };
+    
+    if !config.dns_resolver.is_null() {
+        let dns_resolver = unsafe { CStr::from_ptr(config.dns_resolver) }.to_str().ok()?;
+        resolver_config = resolver_config.with_dns_resolver(dns_resolver.parse::<SocketAddr>().ok()?);
+    }
+    
+    let mut resolver_config = resolver_config
+        .with_timeout(Duration::from_millis(config.timeout_ms))
+        .with_cache_capacity(config.cache_max_entries as usize)
+        .with_metrics(config.enable_metrics != 0)
+        .with_single_flight(config.single_flight != 0)
+        .with_enforced_timeout(config.enforce_timeout != 0);
+    if config.enable_cache != 0 {
+        resolver_config = resolver_config.with_cache_ttl(Duration::from_secs(config.cache_ttl_secs));
+    }
+    if config.max_retries > 0 {
+        resolver_config = resolver_config.with_retry(RetryPolicy {
+            max_retries: config.max_retries,
+            ..RetryPolicy::default()
+        });
+    }
+    if config.rate_limit_per_sec > 0 {
+        resolver_config = resolver_config.with_rate_limit(RateLimit {
+            per_second: config.rate_limit_per_sec,
+            burst: config.rate_limit_per_sec,
+        });
+    }
+    
+    if config.flight_recorder_capacity > 0 {
+        resolver_config = resolver_config.with_flight_recorder(FlightRecorderConfig {
+            capacity: config.flight_recorder_capacity as usize,
+            slow_threshold: Duration::from_millis(config.slow_query_ms as u64),
+            ..FlightRecorderConfig::default()
+        });
+    }
+    
+    Some(resolver_config)
+}
+
+/// Local DNS server with signed zones, for tests and benchmarks (`testing` feature)
+#[cfg(feature = "testing")]
+pub struct Bip353TestServer(crate::testing::DnsServer);
+
+/// Start a local DNS server for `user0@example.com` to `user{users - 1}@example.com`
+///
+/// Every response is delayed by `latency_us`. Returns NULL if the server
+/// cannot bind to localhost.
+#[cfg(feature = "testing")]
+#[no_mangle]
+pub extern "C" fn bip353_test_server_start(users: u64, latency_us: u64) -> *mut Bip353TestServer {
+    use crate::testing::{DnsServer, DnsServerConfig, ZoneConfig};
+    
+    let config = DnsServerConfig {
+        zones: ZoneConfig { users, ..ZoneConfig::default() },
+        ..DnsServerConfig::default()
+    }.with_latency(Duration::from_micros(latency_us));
+    match DnsServer::start(config) {
+        Ok(server) => Box::into_raw(Box::new(Bip353TestServer(server))),
+        Err(_) => ptr::null_mut(),
+    }
+}
+
+/// Stop and free a local DNS server
+///
+/// Resolvers created over it stay valid, but their lookups fail from then on.
+#[cfg(feature = "testing")]
+#[no_mangle]
+pub extern "C" fn bip353_test_server_free(server: *mut Bip353TestServer) {
+    if !server.is_null() {
+        unsafe {
+            let _ = Box::from_raw(server);
+        }
+    }
+}
+
+/// Create a resolver that looks names up on a local DNS server
+///
+/// `config` is applied as by `bip353_resolver_create_with_config`, except
+/// for `dns_resolver`: lookups go to `server` and are validated against its
+/// trust anchor.
+#[cfg(feature = "testing")]
+#[no_mangle]
+pub extern "C" fn bip353_resolver_create_local(
+    server: *const Bip353TestServer,
+    config: *const Bip353Config,
+) -> *mut ResolverPtr {
+    if server.is_null() || config.is_null() {
+        return ptr::null_mut();
+    }
+    
+    let server = &unsafe { &*server }.0;
+    let mut config = match unsafe { read_config(config) } {
+        Some(config) => config,
+        None => return ptr::null_mut(),
+    };
+    config.dns_resolver = ptr::null();
+    match resolver_config(&config) {
+        Some(resolver_config) => ResolverPtr::into_raw(Bip353Resolver::with_hrn_resolver(
+            crate::DynHrnResolver::new(server.resolver()),
+            resolver_config,
+        )),
+        None => ptr::null_mut(),
+    }
+}
+
 /// Free a resolver
 #[no_mangle]
 pub extern "C" fn bip353_resolver_free(ptr: *mut ResolverPtr) {
@@ -84,7 +515,7 @@ pub extern "C" fn bip353_resolver_free(ptr: *mut ResolverPtr) {
 #[repr(C)]
 pub struct Bip353Result {
     /// Whether the resolution was successful
-    success: bool,
+    success: c_int,
     
     /// The URI (BIP-21)
     uri: *mut c_char,
@@ -93,7 +524,7 @@ pub struct Bip353Result {
     payment_type: *mut c_char,
     
     /// Whether the payment is reusable
-    is_reusable: bool,
+    is_reusable: c_int,
     
     /// Error message (if any)
     error: *mut c_char,
@@ -117,12 +548,108 @@ pub extern "C" fn bip353_resolve_address(
         Err(_) => return ptr::null_mut(),
     };
     
-    let runtime = get_runtime();
+    let entry = usdt::sdt_start!(ffi__entry, c"bip353_resolve_address".as_ptr() as usize, address_str.len());
     
-    // Resolve the address
-    let result = runtime.block_on(async {
-        resolver.resolve_address(address_str).await
-    });
+    // Resolve the address (through the layers enabled in the config)
+    let result = get_blocking_runtime()
+        .and_then(|runtime| runtime.block_on(resolver.resolve_address(address_str)));
+    probe_exit(c"bip353_resolve_address", entry, &result);
+    
+    create_result_ptr(result)
+}
+
+/// Fire the `ffi__exit` USDT probe of the entry point `func`
+#[inline]
+fn probe_exit(func: &CStr, entry: Option<Instant>, result: &Result<PaymentInfo, Bip353Error>) {
+    usdt::sdt!(ffi__exit, func.as_ptr() as usize, usdt::latency_us(entry), usdt::status(result));
+}
+
+/// How a resolution was answered (see `ResolutionReport`)
+#[repr(C)]
+pub struct Bip353Report {
+    /// 1 if answered from the cache
+    cache_hit: c_int,
+    
+    /// 1 if an expired cache entry was refreshed
+    stale: c_int,
+    
+    /// 1 if the answer came from a concurrent lookup of the same name
+    coalesced: c_int,
+    
+    /// DNS resolver queried as "ip:port", empty if no DNS query was sent
+    upstream: [c_char; 64],
+    
+    /// Time spent in lookups, including DNSSEC validation, in microseconds
+    rtt_us: u64,
+    
+    /// Lookups sent to the upstream
+    queries: u32,
+    
+    /// Bytes of DNSSEC proofs and records received
+    bytes_received: u64,
+    
+    /// Time spent parsing instructions and building the URI, in microseconds
+    processing_us: u64,
+    
+    /// Wall time of the resolution in microseconds
+    total_us: u64,
+    
+    /// Seconds until the cached answer expires, -1 if not cached
+    ttl_remaining_secs: i64,
+}
+
+impl From<&ResolutionReport> for Bip353Report {
+    fn from(report: &ResolutionReport) -> Self {
+        let mut upstream = [0; 64];
+        if let Some(addr) = report.upstream {
+            let addr = addr.to_string();
+            for (dst, &src) in upstream.iter_mut().zip(addr.as_bytes().iter().take(63)) {
+                *dst = src as c_char;
+            }
+        }
+        
+        Self {
+            cache_hit: (report.cache == CacheStatus::Hit) as c_int,
+            stale: report.stale as c_int,
+            coalesced: report.coalesced as c_int,
+            upstream,
+            rtt_us: report.rtt.as_micros() as u64,
+            queries: report.queries,
+            bytes_received: report.bytes_received,
+            processing_us: report.processing_time.as_micros() as u64,
+            total_us: report.total_time.as_micros() as u64,
+            ttl_remaining_secs: report.ttl_remaining.map_or(-1, |ttl| ttl.as_secs() as i64),
+        }
+    }
+}
+
+/// Resolve a human-readable Bitcoin address and report how it was answered
+///
+/// `report_out` is filled whenever a result is returned, including failures.
+#[no_mangle]
+pub extern "C" fn bip353_resolve_address_with_report(
+    ptr: *const ResolverPtr,
+    address: *const c_char,
+    report_out: *mut Bip353Report,
+) -> *mut Bip353Result {
+    if ptr.is_null() || address.is_null() || report_out.is_null() {
+        return ptr::null_mut();
+    }
+    
+    let resolver = &unsafe { &*ptr }.0;
+    
+    let address_str = match unsafe { CStr::from_ptr(address) }.to_str() {
+        Ok(s) => s,
+        Err(_) => return ptr::null_mut(),
+    };
+    
+    let entry = usdt::sdt_start!(ffi__entry, c"bip353_resolve_address_with_report".as_ptr() as usize, address_str.len());
+    let (result, report) = match get_blocking_runtime() {
+        Ok(runtime) => runtime.block_on(resolver.resolve_address_with_report(address_str)),
+        Err(err) => (Err(err), ResolutionReport::default()),
+    };
+    unsafe { *report_out = Bip353Report::from(&report) };
+    probe_exit(c"bip353_resolve_address_with_report", entry, &result);
     
     create_result_ptr(result)
 }
@@ -151,57 +678,312 @@ pub extern "C" fn bip353_resolve(
         Err(_) => return ptr::null_mut(),
     };
     
-    let runtime = get_runtime();
+    let entry = usdt::sdt_start!(ffi__entry, c"bip353_resolve".as_ptr() as usize, user_str.len() + 1 + domain_str.len());
     
     // Resolve the address
-    let result = runtime.block_on(async {
-        resolver.resolve(user_str, domain_str).await
-    });
+    let result = get_blocking_runtime().and_then(|runtime| runtime.block_on(async {
+        resolver.resolve_with_safety_checks(user_str, domain_str).await
+            .map(|safe_info| safe_info.payment_info)
+    }));
+    probe_exit(c"bip353_resolve", entry, &result);
     
     create_result_ptr(result)
 }
 
-fn create_result_ptr(result: Result<PaymentInfo, Bip353Error>) -> *mut Bip353Result {
-    let result_ptr = Box::new(match result {
-        Ok(info) => {
-            // Convert to C strings
-            let uri_cstring = match CString::new(info.uri) {
-                Ok(s) => s,
-                Err(_) => return ptr::null_mut(),
-            };
-            
-            let type_str = info.payment_type.to_string();
-            let type_cstring = match CString::new(type_str) {
-                Ok(s) => s,
-                Err(_) => return ptr::null_mut(),
-            };
-            
-            Bip353Result {
-                success: true,
-                uri: uri_cstring.into_raw(),
-                payment_type: type_cstring.into_raw(),
-                is_reusable: info.is_reusable,
-                error: ptr::null_mut(),
-            }
+/// Cancellation handle for a single resolution
+///
+/// Created with `bip353_request_create`, passed to one resolve call and
+/// cancelled from any thread with `bip353_request_cancel`.
+pub struct Bip353Request {
+    handle: AbortHandle,
+    registration: Mutex<Option<AbortRegistration>>,
+}
+
+impl Bip353Request {
+    /// Take the registration that ties this handle to a resolution
+    fn register(&self) -> Result<AbortRegistration, Bip353Error> {
+        self.registration.lock().unwrap_or_else(PoisonError::into_inner).take()
+            .ok_or_else(|| Bip353Error::ImplError("Request handle already used".into()))
+    }
+}
+
+/// Create a cancellation handle for one resolution
+#[no_mangle]
+pub extern "C" fn bip353_request_create() -> *mut Bip353Request {
+    let (handle, registration) = AbortHandle::new_pair();
+    Box::into_raw(Box::new(Bip353Request {
+        handle,
+        registration: Mutex::new(Some(registration)),
+    }))
+}
+
+/// Cancel the resolution associated with a handle
+///
+/// The in-flight lookup is dropped, closing its upstream connection, and the
+/// call completes with a "Cancelled" error. Cancelling before the call starts
+/// makes it complete immediately.
+#[no_mangle]
+pub extern "C" fn bip353_request_cancel(request: *const Bip353Request) {
+    if !request.is_null() {
+        unsafe { &*request }.handle.abort();
+    }
+}
+
+/// Free a cancellation handle
+#[no_mangle]
+pub extern "C" fn bip353_request_free(request: *mut Bip353Request) {
+    if !request.is_null() {
+        unsafe {
+            let _ = Box::from_raw(request);
         }
-        Err(err) => {
-            let error_str = err.to_string_representation();
-            let error_cstring = match CString::new(error_str) {
-                Ok(s) => s,
-                Err(_) => return ptr::null_mut(),
-            };
-            
-            Bip353Result {
-                success: false,
-                uri: ptr::null_mut(),
-                payment_type: ptr::null_mut(),
-                is_reusable: false,
-                error: error_cstring.into_raw(),
-            }
+    }
+}
+
+/// Resolve an address under a deadline, aborting when the registration is cancelled
+async fn resolve_with_deadline(
+    resolver: &Bip353Resolver,
+    address: &str,
+    timeout_ms: u64,
+    registration: Option<AbortRegistration>,
+) -> Result<PaymentInfo, Bip353Error> {
+    let timeout = if timeout_ms == 0 {
+        resolver.config().timeout()
+    } else {
+        Duration::from_millis(timeout_ms)
+    };
+    
+    let resolution = tokio::time::timeout(timeout, resolver.resolve_address(address));
+    
+    let outcome = match registration {
+        Some(registration) => Abortable::new(resolution, registration).await
+            .map_err(|_| Bip353Error::Cancelled),
+        None => Ok(resolution.await),
+    };
+    
+    // A timed out or cancelled resolution is dropped before its metrics layer sees an outcome
+    let err = match outcome {
+        Ok(Ok(result)) => return result,
+        Ok(Err(_)) => Bip353Error::Timeout(format!("no answer within {}ms", timeout.as_millis())),
+        Err(err) => err,
+    };
+    resolver.record_failure(&err);
+    Err(err)
+}
+
+/// Resolve a human-readable Bitcoin address with a deadline and optional cancellation
+#[no_mangle]
+pub extern "C" fn bip353_resolve_address_with_deadline(
+    ptr: *const ResolverPtr,
+    address: *const c_char,
+    timeout_ms: u64,
+    request: *const Bip353Request,
+) -> *mut Bip353Result {
+    if ptr.is_null() || address.is_null() {
+        return ptr::null_mut();
+    }
+    
+    let resolver = &unsafe { &*ptr }.0;
+    
+    let address_str = match unsafe { CStr::from_ptr(address) }.to_str() {
+        Ok(s) => s,
+        Err(_) => return ptr::null_mut(),
+    };
+    
+    let registration = if request.is_null() {
+        None
+    } else {
+        match unsafe { &*request }.register() {
+            Ok(registration) => Some(registration),
+            Err(err) => return create_result_ptr(Err(err)),
         }
+    };
+    
+    let entry = usdt::sdt_start!(ffi__entry, c"bip353_resolve_address_with_deadline".as_ptr() as usize, address_str.len());
+    let result = get_blocking_runtime()
+        .and_then(|runtime| runtime.block_on(resolve_with_deadline(resolver, address_str, timeout_ms, registration)));
+    probe_exit(c"bip353_resolve_address_with_deadline", entry, &result);
+    
+    create_result_ptr(result)
+}
+
+/// Callback receiving the result of an asynchronous resolution
+pub type Bip353ResultCallback = extern "C" fn(result: *mut Bip353Result, user_data: *mut c_void);
+
+/// User data pointer handed back to the callback on a runtime thread
+struct CallbackData(*mut c_void);
+
+unsafe impl Send for CallbackData {}
+
+impl CallbackData {
+    fn into_raw(self) -> *mut c_void {
+        self.0
+    }
+}
+
+/// Resolve a human-readable Bitcoin address without blocking the caller
+///
+/// The callback is invoked exactly once, on a runtime worker thread, and owns
+/// the result. Returns 1 if the resolution was started, 0 on invalid arguments
+/// or when the runtime was initialized without worker threads (the callback
+/// is then never invoked).
+#[no_mangle]
+pub extern "C" fn bip353_resolve_address_async(
+    ptr: *const ResolverPtr,
+    address: *const c_char,
+    timeout_ms: u64,
+    request: *const Bip353Request,
+    callback: Option<Bip353ResultCallback>,
+    user_data: *mut c_void,
+) -> c_int {
+    let callback = match callback {
+        Some(callback) if !ptr.is_null() && !address.is_null() => callback,
+        _ => return 0,
+    };
+    
+    let resolver = unsafe { &*ptr }.0.clone();
+    
+    let address_str = match unsafe { CStr::from_ptr(address) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => return 0,
+    };
+    
+    let runtime = match get_spawn_runtime() {
+        Some(runtime) => runtime,
+        None => return 0,
+    };
+    
+    let registration = if request.is_null() {
+        Ok(None)
+    } else {
+        unsafe { &*request }.register().map(Some)
+    };
+    
+    // The exit probe fires on the worker thread, just before the callback
+    let entry = usdt::sdt_start!(ffi__entry, c"bip353_resolve_address_async".as_ptr() as usize, address_str.len());
+    let user_data = CallbackData(user_data);
+    let task_runtime = runtime.clone();
+    runtime.spawn(async move {
+        // Keeps bip353_shutdown waiting until the callback has run
+        let _runtime = task_runtime;
+        
+        let result = match registration {
+            Ok(registration) => resolve_with_deadline(&resolver, &address_str, timeout_ms, registration).await,
+            Err(err) => Err(err),
+        };
+        probe_exit(c"bip353_resolve_address_async", entry, &result);
+        
+        callback(create_result_ptr(result), user_data.into_raw());
     });
     
-    Box::into_raw(result_ptr)
+    1
+}
+
+/// Return a cached resolution without blocking
+///
+/// Returns NULL on a miss (or invalid arguments). With `schedule_fill` set, a
+/// miss starts a background resolution that populates the cache for later
+/// probes, unless one is already running for the address or the runtime has
+/// no worker threads to run it. The hit path never enters the runtime.
+#[no_mangle]
+pub extern "C" fn bip353_try_resolve_cached(
+    ptr: *const ResolverPtr,
+    address: *const c_char,
+    schedule_fill: c_int,
+) -> *mut Bip353Result {
+    if ptr.is_null() || address.is_null() {
+        return ptr::null_mut();
+    }
+    
+    let resolver = &unsafe { &*ptr }.0;
+    
+    let address_str = match unsafe { CStr::from_ptr(address) }.to_str() {
+        Ok(s) => s,
+        Err(_) => return ptr::null_mut(),
+    };
+    
+    let (user, domain) = match crate::split_address(address_str) {
+        Ok(parts) => parts,
+        Err(_) => return ptr::null_mut(),
+    };
+    
+    if let Some(result) = resolver.with_cached(&cache_key(address_str, user, domain), |info| {
+        success_result_ptr(&info.uri, &info.payment_type, info.is_reusable)
+    }) {
+        return result;
+    }
+    
+    // A started fill counts the miss in the cache layer, as any resolution does
+    let fill = (schedule_fill != 0).then(get_spawn_runtime).flatten()
+        .and_then(|runtime| Some((runtime, resolver.cache_fill(user, domain)?)));
+    match fill {
+        Some((runtime, fill)) => {
+            let task_runtime = runtime.clone();
+            runtime.spawn(async move {
+                let _runtime = task_runtime;
+                fill.await;
+            });
+        }
+        None => resolver.record_cache_miss(),
+    }
+    
+    ptr::null_mut()
+}
+
+/// The cache key ("user@domain") for the parts split from `address`
+///
+/// Borrowed from `address` unless trimming left whitespace around the '@'.
+fn cache_key<'a>(address: &'a str, user: &'a str, domain: &'a str) -> Cow<'a, str> {
+    let start = user.as_ptr() as usize - address.as_ptr() as usize;
+    let at = start + user.len();
+    if domain.as_ptr() as usize == address.as_ptr() as usize + at + 1 {
+        Cow::Borrowed(&address[start..at + 1 + domain.len()])
+    } else {
+        Cow::Owned(format!("{}@{}", user, domain))
+    }
+}
+
+/// Build a success result, copying the URI and payment type into C strings
+fn success_result_ptr(uri: &str, payment_type: &PaymentType, is_reusable: bool) -> *mut Bip353Result {
+    let _stage = alloc_profile::enter(AllocStage::Ffi);
+    let uri_cstring = match CString::new(uri) {
+        Ok(s) => s,
+        Err(_) => return ptr::null_mut(),
+    };
+    
+    let type_cstring = match CString::new(payment_type.to_string()) {
+        Ok(s) => s,
+        Err(_) => return ptr::null_mut(),
+    };
+    
+    Box::into_raw(Box::new(Bip353Result {
+        success: 1,
+        uri: uri_cstring.into_raw(),
+        payment_type: type_cstring.into_raw(),
+        is_reusable: is_reusable as c_int,
+        error: ptr::null_mut(),
+    }))
+}
+
+fn create_result_ptr(result: Result<PaymentInfo, Bip353Error>) -> *mut Bip353Result {
+    let _stage = alloc_profile::enter(AllocStage::Ffi);
+    let err = match result {
+        Ok(info) => return success_result_ptr(&info.uri, &info.payment_type, info.is_reusable),
+        Err(err) => err,
+    };
+    
+    let error_str = err.to_string_representation();
+    let error_cstring = match CString::new(error_str) {
+        Ok(s) => s,
+        Err(_) => return ptr::null_mut(),
+    };
+    
+    Box::into_raw(Box::new(Bip353Result {
+        success: 0,
+        uri: ptr::null_mut(),
+        payment_type: ptr::null_mut(),
+        is_reusable: 0,
+        error: error_cstring.into_raw(),
+    }))
 }
 
 /// Free a result
@@ -233,14 +1015,14 @@ pub extern "C" fn bip353_parse_address(
     address: *const c_char,
     user_out: *mut *mut c_char,
     domain_out: *mut *mut c_char,
-) -> bool {
+) -> c_int {
     if address.is_null() || user_out.is_null() || domain_out.is_null() {
-        return false;
+        return 0;
     }
     
     let address_str = match unsafe { CStr::from_ptr(address) }.to_str() {
         Ok(s) => s,
-        Err(_) => return false,
+        Err(_) => return 0,
     };
     
     match crate::parse_address(address_str) {
@@ -250,7 +1032,7 @@ pub extern "C" fn bip353_parse_address(
                     Ok(user_cstring) => {
                         *user_out = user_cstring.into_raw();
                     }
-                    Err(_) => return false,
+                    Err(_) => return 0,
                 }
                 
                 match CString::new(domain) {
@@ -261,14 +1043,48 @@ pub extern "C" fn bip353_parse_address(
                         // Free the user string if domain allocation fails
                         let _ = CString::from_raw(*user_out);
                         *user_out = ptr::null_mut();
-                        return false;
+                        return 0;
                     }
                 }
             }
             
-            true
+            1
         }
-        Err(_) => false,
+        Err(_) => 0,
+    }
+}
+
+/// Render the resolver's metrics in OpenMetrics text format
+///
+/// Returns NULL if metrics are disabled (or on invalid arguments). Free the
+/// text with `bip353_string_free`.
+#[no_mangle]
+pub extern "C" fn bip353_metrics_render(ptr: *const ResolverPtr) -> *mut c_char {
+    if ptr.is_null() {
+        return ptr::null_mut();
+    }
+    
+    let resolver = &unsafe { &*ptr }.0;
+    match resolver.render_metrics().map(CString::new) {
+        Some(Ok(text)) => text.into_raw(),
+        _ => ptr::null_mut(),
+    }
+}
+
+/// Dump the flight recorder as JSON lines, oldest first
+///
+/// Returns NULL if the flight recorder is disabled (or on invalid arguments).
+/// Free the text with `bip353_string_free`.
+#[no_mangle]
+pub extern "C" fn bip353_flight_recorder_dump(ptr: *const ResolverPtr) -> *mut c_char {
+    if ptr.is_null() {
+        return ptr::null_mut();
+    }
+    
+    let resolver = &unsafe { &*ptr }.0;
+    match resolver.flight_recorder().map(|recorder| CString::new(recorder.dump_json())) {
+        Some(Ok(text)) => text.into_raw(),
+        _ => ptr::null_mut(),
     }
 }
 
@@ -281,3 +1097,283 @@ pub extern "C" fn bip353_string_free(ptr: *mut c_char) {
         }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    
+    #[test]
+    fn test_create_with_config() {
+        let _guard = RUNTIME_TEST_LOCK.lock().unwrap_or_else(PoisonError::into_inner);
+        let mut config = Bip353Config::default();
+        bip353_config_init(&mut config);
+        config.enable_cache = 1;
+        config.enable_metrics = 1;
+        config.single_flight = 1;
+        config.enforce_timeout = 1;
+        config.max_retries = 2;
+        config.rate_limit_per_sec = 50;
+        config.flight_recorder_capacity = 16;
+        // Nothing listens there, so lookups fail fast without network access
+        let dns = CString::new("127.0.0.1:1").unwrap();
+        config.dns_resolver = dns.as_ptr();
+        config.timeout_ms = 500;
+        
+        let resolver = bip353_resolver_create_with_config(&config);
+        assert!(!resolver.is_null());
+        
+        let text = bip353_metrics_render(resolver);
+        assert!(!text.is_null());
+        assert!(unsafe { CStr::from_ptr(text) }.to_str().unwrap().ends_with("# EOF\n"));
+        bip353_string_free(text);
+        
+        // A malformed address fails without any lookup
+        let mut report = unsafe { mem::zeroed::<Bip353Report>() };
+        let address = CString::new("not-an-address").unwrap();
+        let result = bip353_resolve_address_with_report(resolver, address.as_ptr(), &mut report);
+        assert!(!result.is_null());
+        assert_eq!(report.queries, 0);
+        assert_eq!(report.ttl_remaining_secs, -1);
+        bip353_result_free(result);
+        
+        // Only lookups that get past parsing are recorded
+        let address = CString::new("alice@example.com").unwrap();
+        let result = bip353_resolve_address(resolver, address.as_ptr());
+        assert_eq!(unsafe { &*result }.success, 0);
+        bip353_result_free(result);
+        
+        let dump = bip353_flight_recorder_dump(resolver);
+        assert!(!dump.is_null());
+        let records: Vec<&str> = unsafe { CStr::from_ptr(dump) }.to_str().unwrap().lines().collect();
+        assert_eq!(records.len(), 1);
+        assert!(records[0].contains("\"cache\":\"miss\""));
+        assert!(!records[0].contains("\"outcome\":\"success\""));
+        bip353_string_free(dump);
+        bip353_resolver_free(resolver);
+        
+        // Reserved fields only accept their defaults
+        config.enforce_dnssec = 0;
+        assert!(bip353_resolver_create_with_config(&config).is_null());
+        config.enforce_dnssec = 1;
+        config.allow_http_fallback = 1;
+        assert!(bip353_resolver_create_with_config(&config).is_null());
+        config.allow_http_fallback = 0;
+        
+        // Invalid resolver address is rejected
+        let dns = CString::new("not-an-address").unwrap();
+        config.dns_resolver = dns.as_ptr();
+        assert!(bip353_resolver_create_with_config(&config).is_null());
+    }
+    
+    #[cfg(feature = "testing")]
+    #[test]
+    fn test_create_local() {
+        let _guard = RUNTIME_TEST_LOCK.lock().unwrap_or_else(PoisonError::into_inner);
+        let server = bip353_test_server_start(10, 0);
+        assert!(!server.is_null());
+        let mut config = Bip353Config::default();
+        bip353_config_init(&mut config);
+        config.enable_cache = 1;
+        let resolver = bip353_resolver_create_local(server, &config);
+        assert!(!resolver.is_null());
+        
+        let address = CString::new("user1@example.com").unwrap();
+        let result = bip353_resolve_address(resolver, address.as_ptr());
+        let result_ref = unsafe { &*result };
+        assert_eq!(result_ref.success, 1);
+        let uri = unsafe { CStr::from_ptr(result_ref.uri) }.to_str().unwrap();
+        assert_eq!(uri, crate::testing::DEFAULT_RECORD);
+        bip353_result_free(result);
+        
+        // Users beyond the served range do not exist
+        let address = CString::new("user10@example.com").unwrap();
+        let result = bip353_resolve_address(resolver, address.as_ptr());
+        assert_eq!(unsafe { &*result }.success, 0);
+        bip353_result_free(result);
+        
+        // A miss schedules a fill that later probes hit
+        let address = CString::new("user2@example.com").unwrap();
+        assert!(bip353_try_resolve_cached(resolver, address.as_ptr(), 1).is_null());
+        let deadline = Instant::now() + Duration::from_secs(5);
+        let result = loop {
+            let result = bip353_try_resolve_cached(resolver, address.as_ptr(), 0);
+            if !result.is_null() || Instant::now() > deadline {
+                break result;
+            }
+            std::thread::sleep(Duration::from_millis(5));
+        };
+        assert!(!result.is_null());
+        assert_eq!(unsafe { &*result }.success, 1);
+        bip353_result_free(result);
+        
+        // Any spelling of the address probes the same entry
+        let address = CString::new(" ₿user2 @ example.com").unwrap();
+        let result = bip353_try_resolve_cached(resolver, address.as_ptr(), 0);
+        assert!(!result.is_null());
+        bip353_result_free(result);
+        
+        bip353_resolver_free(resolver);
+        bip353_test_server_free(server);
+    }
+    
+    // Tests that start or stop the global runtime must not overlap
+    static RUNTIME_TEST_LOCK: Mutex<()> = Mutex::new(());
+    
+    #[test]
+    fn test_runtime_lifecycle() {
+        let _guard = RUNTIME_TEST_LOCK.lock().unwrap_or_else(PoisonError::into_inner);
+        bip353_shutdown(0);
+        
+        let prefix = CString::new("bip353-test").unwrap();
+        assert_eq!(bip353_init(1, prefix.as_ptr(), 0), 1);
+        
+        // A second init while running is refused
+        assert_eq!(bip353_init(1, ptr::null(), 0), 0);
+        
+        let runtime = get_runtime();
+        assert_eq!(runtime.block_on(async { 1 + 1 }), 2);
+        drop(runtime);
+        
+        assert_eq!(bip353_shutdown(1000), 1);
+        assert_eq!(bip353_shutdown(0), 1);
+    }
+    
+    extern "C" fn unreachable_callback(result: *mut Bip353Result, _user_data: *mut c_void) {
+        bip353_result_free(result);
+        panic!("callback invoked without worker threads");
+    }
+    
+    #[test]
+    fn test_current_thread_runtime_spawns_nothing() {
+        let _guard = RUNTIME_TEST_LOCK.lock().unwrap_or_else(PoisonError::into_inner);
+        bip353_shutdown(0);
+        assert_eq!(bip353_init(0, ptr::null(), 1), 1);
+        
+        let mut config = Bip353Config::default();
+        bip353_config_init(&mut config);
+        config.enable_cache = 1;
+        let resolver = bip353_resolver_create_with_config(&config);
+        let address = CString::new("alice@example.com").unwrap();
+        
+        // Nothing would drive a spawned task, so neither call starts one
+        let started = bip353_resolve_address_async(resolver, address.as_ptr(), 0, ptr::null(), Some(unreachable_callback), ptr::null_mut());
+        assert_eq!(started, 0);
+        assert!(bip353_try_resolve_cached(resolver, address.as_ptr(), 1).is_null());
+        assert!(unsafe { &*resolver }.0.cache_fill("alice", "example.com").is_some());
+        
+        bip353_resolver_free(resolver);
+        assert_eq!(bip353_shutdown(1000), 1);
+    }
+    
+    /// Makes the calls that must not block or hang inside a callback
+    extern "C" fn reentrant_callback(result: *mut Bip353Result, user_data: *mut c_void) {
+        bip353_result_free(result);
+        let sender = unsafe { Box::from_raw(user_data as *mut std::sync::mpsc::Sender<(c_int, String)>) };
+        
+        let address = CString::new("alice@example.com").unwrap();
+        let resolver = bip353_resolver_create();
+        let nested = bip353_resolve_address(resolver, address.as_ptr());
+        let error = unsafe { CStr::from_ptr((*nested).error) }.to_str().unwrap().to_string();
+        bip353_result_free(nested);
+        bip353_resolver_free(resolver);
+        
+        sender.send((bip353_shutdown(0), error)).unwrap();
+    }
+    
+    #[test]
+    fn test_reentry_from_callback_fails() {
+        let _guard = RUNTIME_TEST_LOCK.lock().unwrap_or_else(PoisonError::into_inner);
+        let resolver = bip353_resolver_create();
+        let address = CString::new("not-an-address").unwrap();
+        
+        let (sender, receiver) = std::sync::mpsc::channel::<(c_int, String)>();
+        let user_data = Box::into_raw(Box::new(sender)) as *mut c_void;
+        let started = bip353_resolve_address_async(resolver, address.as_ptr(), 0, ptr::null(), Some(reentrant_callback), user_data);
+        assert_eq!(started, 1);
+        
+        let (shutdown, error) = receiver.recv_timeout(Duration::from_secs(10)).unwrap();
+        assert_eq!(shutdown, -1);
+        assert!(error.contains("runtime thread"), "{}", error);
+        
+        bip353_resolver_free(resolver);
+        assert_eq!(bip353_shutdown(1000), 1);
+    }
+    
+    #[test]
+    fn test_cancelled_request() {
+        let _guard = RUNTIME_TEST_LOCK.lock().unwrap_or_else(PoisonError::into_inner);
+        let resolver = bip353_resolver_create();
+        let address = CString::new("alice@example.com").unwrap();
+        
+        let request = bip353_request_create();
+        bip353_request_cancel(request);
+        
+        let result = bip353_resolve_address_with_deadline(resolver, address.as_ptr(), 0, request);
+        let error = unsafe { CStr::from_ptr((*result).error) }.to_str().unwrap().to_string();
+        assert_eq!(unsafe { &*result }.success, 0);
+        assert_eq!(error, Bip353Error::Cancelled.to_string());
+        bip353_result_free(result);
+        
+        // A handle only covers a single call
+        let result = bip353_resolve_address_with_deadline(resolver, address.as_ptr(), 0, request);
+        assert_eq!(unsafe { &*result }.success, 0);
+        bip353_result_free(result);
+        
+        bip353_request_free(request);
+        bip353_resolver_free(resolver);
+    }
+    
+    #[test]
+    fn test_cache_key() {
+        for (address, borrowed) in [
+            ("alice@example.com", true),
+            ("  ₿alice@example.com ", true),
+            ("alice @ example.com", false),
+        ] {
+            let (user, domain) = crate::split_address(address).unwrap();
+            let key = cache_key(address, user, domain);
+            assert_eq!(key, "alice@example.com");
+            assert_eq!(matches!(key, Cow::Borrowed(_)), borrowed, "{:?}", address);
+        }
+    }
+    
+    #[test]
+    fn test_config_size_prefix() {
+        // A caller that only knows the header gets defaults for everything else
+        let mut config = Bip353Config::default();
+        config.struct_size = 8;
+        config.timeout_ms = 1;
+        let read = unsafe { read_config(&config) }.unwrap();
+        assert_eq!(read.timeout_ms, ResolverConfig::default().timeout_ms);
+        
+        // A caller built against a newer header may append fields left at zero
+        #[repr(C)]
+        #[allow(dead_code)]
+        struct NewerConfig {
+            config: Bip353Config,
+            appended: u64,
+        }
+        let mut newer = NewerConfig {
+            config: Bip353Config::default(),
+            appended: 0,
+        };
+        newer.config.struct_size = mem::size_of::<NewerConfig>() as u32;
+        newer.config.cache_max_entries = 7;
+        let newer_ptr = &newer as *const NewerConfig as *const Bip353Config;
+        let read = unsafe { read_config(newer_ptr) }.unwrap();
+        assert_eq!(read.cache_max_entries, 7);
+        assert_eq!(read.struct_size as usize, mem::size_of::<Bip353Config>());
+        
+        // ...but not set any of them
+        newer.appended = 1;
+        let newer_ptr = &newer as *const NewerConfig as *const Bip353Config;
+        assert!(unsafe { read_config(newer_ptr) }.is_none());
+        
+        // An uninitialized header, a size ending inside a field or an unknown layout is rejected
+        let before_middleware = mem::offset_of!(Bip353Config, single_flight) as u32;
+        for size in [0, 4, 12, before_middleware, mem::size_of::<Bip353Config>() as u32 - 4] {
+            config.struct_size = size;
+            assert!(unsafe { read_config(&config) }.is_none(), "size {}", size);
+        }
+    }
+}
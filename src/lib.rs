@@ -12,45 +12,80 @@ mod resolver;
 mod types;
 mod config;
 mod metrics;     
+mod exporter;
+mod trace;
+mod report;
+mod recorder;
+mod usdt;
+#[cfg_attr(not(feature = "alloc-profile"), allow(dead_code))]
+mod alloc_profile;
+pub mod middleware;
 mod monitoring;   
 
+#[cfg(any(feature = "ffi", feature = "python"))]
+mod runtime;
+
 #[cfg(feature = "ffi")]
 pub mod ffi;
 
 #[cfg(feature = "python")]
 pub mod python;
 
-pub use error::Bip353Error;
-pub use resolver::{Bip353Resolver, ResolverType};
+#[cfg(feature = "testing")]
+pub mod testing;
+
+pub use error::{Bip353Error, ErrorKind};
+pub use resolver::{Bip353Resolver, CoreResolver, DynHrnResolver, ResolverType};
+pub use bitcoin_payment_instructions::hrn_resolution::HrnResolver;
 pub use types::{PaymentInfo, PaymentType};
-pub use config::ResolverConfig;
-pub use metrics::{Bip353Metrics, ResolutionStats, CacheStats};
+pub use config::{FlightRecorderConfig, LayerConfig, RateLimit, ResolverConfig, RetryPolicy};
+pub use metrics::{
+    Bip353Metrics, ResolutionStats, CacheStats, DomainStats, FailureStats,
+    LatencyHistogram, LatencyOutcome, LatencyStats, LatencySummary,
+};
+pub use exporter::{render_openmetrics, OPENMETRICS_CONTENT_TYPE};
+pub use recorder::{FlightRecord, FlightRecorder};
+pub use report::{CacheStatus, ResolutionReport};
 pub use monitoring::{ChainMonitor, ChainBackend, AddressUsedEvent};
+#[cfg(feature = "alloc-profile")]
+pub use alloc_profile::{
+    process_stats, thread_stats, AllocCount, AllocStage, AllocStats, CountingAllocator,
+    CACHED_RESOLUTION_BUDGET, UNCACHED_RESOLUTION_BUDGET,
+};
+
+/// Internals exposed to the benchmarks, not part of the public API
+#[doc(hidden)]
+pub mod bench {
+    pub use crate::resolver::payment_uri;
+}
 
 /// BIP-353 Bitcoin address parsing utility
 ///
 /// Parses a human-readable Bitcoin address in the format
 /// user@domain or ₿user@domain and returns the user and domain parts.
 pub fn parse_address(address: &str) -> Result<(String, String), Bip353Error> {
+    let (user, domain) = split_address(address)?;
+    Ok((user.to_string(), domain.to_string()))
+}
+
+/// Split an address as `parse_address` does, borrowing the parts from it
+pub(crate) fn split_address(address: &str) -> Result<(&str, &str), Bip353Error> {
     let addr = address.trim();
     
     // Remove Bitcoin prefix if present
     let addr = addr.strip_prefix("₿").unwrap_or(addr);
     
     // Split by @
-    let parts: Vec<&str> = addr.split('@').collect();
-    if parts.len() != 2 {
-        return Err(Bip353Error::InvalidAddress("Address must be in format user@domain".into()));
-    }
-    
-    let user = parts[0].trim();
-    let domain = parts[1].trim();
+    let (user, domain) = match addr.split_once('@') {
+        Some((user, domain)) if !domain.contains('@') => (user.trim(), domain.trim()),
+        _ => return Err(Bip353Error::InvalidAddress("Address must be in format user@domain".into())),
+    };
     
     if user.is_empty() || domain.is_empty() {
         return Err(Bip353Error::InvalidAddress("User and domain cannot be empty".into()));
     }
     
-    Ok((user.to_string(), domain.to_string()))
+    Ok((user, domain))
 }
 
 #[cfg(test)]
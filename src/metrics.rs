@@ -1,17 +1,89 @@
 //! This should show metrics collection for basic operations
 
-use std::sync::atomic::{AtomicU64, Ordering};
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, OnceLock, PoisonError, TryLockError};
 use std::time::Duration;
 
+use crate::error::ErrorKind;
+
+// Counter slots in Bip353Metrics::counters
+const RESOLUTIONS_TOTAL: usize = 0;
+const RESOLUTIONS_SUCCESS: usize = 1;
+const RESOLUTIONS_FAILED: usize = 2;
+const CACHE_HITS: usize = 3;
+const CACHE_MISSES: usize = 4;
+const ADDRESS_REUSE_DETECTED: usize = 5;
+const DOMAIN_SAMPLES_DROPPED: usize = 6;
+const FAILURES_BY_KIND: usize = 7;
+const COUNTERS: usize = FAILURES_BY_KIND + ErrorKind::ALL.len();
+
 #[derive(Debug, Default)]
 pub struct Bip353Metrics {
-    // Counters
-    resolutions_total: AtomicU64,
-    resolutions_success: AtomicU64,
-    resolutions_failed: AtomicU64,
-    cache_hits: AtomicU64,
-    cache_misses: AtomicU64,
-    address_reuse_detected: AtomicU64,
+    // Counters, sharded per thread
+    counters: ShardedCounters<COUNTERS>,
+    
+    // Latency of each resolution by outcome
+    hit_latency: LatencyHistogram,
+    miss_latency: LatencyHistogram,
+    error_latency: LatencyHistogram,
+    
+    // Heaviest domains by lookups
+    domains: DomainTracker,
+}
+
+// Number of shards of counters, histograms and domain tables; threads beyond
+// this share shards round-robin
+const SHARDS: usize = 64;
+
+/// Shard of the calling thread, assigned on first use
+fn shard_index() -> usize {
+    static NEXT_SHARD: AtomicUsize = AtomicUsize::new(0);
+    thread_local! {
+        static SHARD: usize = NEXT_SHARD.fetch_add(1, Ordering::Relaxed) % SHARDS;
+    }
+    SHARD.with(|shard| *shard)
+}
+
+/// One thread's copy of a set of counters, on its own cache lines
+///
+/// 128-byte alignment keeps adjacent-line prefetching from pairing shards.
+#[derive(Debug)]
+#[repr(align(128))]
+struct CounterShard<const N: usize>([AtomicU64; N]);
+
+/// Set of `N` counters split into per-thread shards that are summed on read
+///
+/// Each thread increments only its own shard, so concurrent recording never
+/// shares a cache line between cores.
+#[derive(Debug)]
+struct ShardedCounters<const N: usize> {
+    shards: Box<[CounterShard<N>]>,
+}
+
+impl<const N: usize> Default for ShardedCounters<N> {
+    fn default() -> Self {
+        Self {
+            shards: (0..SHARDS)
+                .map(|_| CounterShard(std::array::from_fn(|_| AtomicU64::new(0))))
+                .collect(),
+        }
+    }
+}
+
+impl<const N: usize> ShardedCounters<N> {
+    /// Shard of the calling thread
+    fn shard(&self) -> &CounterShard<N> {
+        &self.shards[shard_index()]
+    }
+    
+    fn add(&self, counter: usize, n: u64) {
+        self.shard().0[counter].fetch_add(n, Ordering::Relaxed);
+    }
+    
+    fn get(&self, counter: usize) -> u64 {
+        self.shards.iter().map(|shard| shard.0[counter].load(Ordering::Relaxed)).sum()
+    }
 }
 
 #[derive(Debug, Clone)]
@@ -22,6 +94,19 @@ pub struct ResolutionStats {
     pub success_rate: f64,
 }
 
+/// Failure counts by error kind
+#[derive(Debug, Clone, Default)]
+pub struct FailureStats {
+    pub counts: Vec<(ErrorKind, u64)>,
+}
+
+impl FailureStats {
+    /// Failures of one kind
+    pub fn get(&self, kind: ErrorKind) -> u64 {
+        self.counts.iter().find(|(k, _)| *k == kind).map_or(0, |(_, n)| *n)
+    }
+}
+
 #[derive(Debug, Clone)]
 pub struct CacheStats {
     pub hits: u64,
@@ -30,43 +115,451 @@ pub struct CacheStats {
     pub hit_rate: f64,
 }
 
+/// Outcome of a resolution, for latency recording
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum LatencyOutcome {
+    /// Answered from the cache
+    CacheHit,
+    /// Resolved through the network
+    CacheMiss,
+    /// Failed
+    Error,
+}
+
+/// Percentile snapshot of one latency histogram
+///
+/// Percentiles are bucket upper bounds, accurate to about 3%.
+#[derive(Debug, Clone, Default)]
+pub struct LatencySummary {
+    pub count: u64,
+    pub sum: Duration,
+    pub mean: Duration,
+    pub p50: Duration,
+    pub p90: Duration,
+    pub p99: Duration,
+    pub p999: Duration,
+    pub max: Duration,
+}
+
+#[derive(Debug, Clone, Default)]
+pub struct LatencyStats {
+    pub cache_hit: LatencySummary,
+    pub cache_miss: LatencySummary,
+    pub error: LatencySummary,
+}
+
+// Log-linear buckets over microseconds, in the style of HdrHistogram: values
+// below 2^(SUB_BUCKET_BITS + 1) get one bucket each, and every power of two
+// above that is split into 2^SUB_BUCKET_BITS buckets.
+const SUB_BUCKET_BITS: u32 = 5;
+const SUB_BUCKETS: usize = 1 << SUB_BUCKET_BITS;
+const LINEAR_BUCKETS: usize = 2 * SUB_BUCKETS;
+// Highest bit tracked (2^38us is about three days); larger values saturate
+const MAX_VALUE_BIT: u32 = 38;
+const BUCKETS: usize = LINEAR_BUCKETS + (MAX_VALUE_BIT - SUB_BUCKET_BITS) as usize * SUB_BUCKETS;
+
+/// Lock-free latency histogram
+///
+/// Each thread records into its own shard and summaries add the shards up.
+/// A shard is allocated on the first recording into it, and threads sharing
+/// that shard wait for the allocation; from then on recording is a fixed
+/// number of relaxed atomic adds, wait-free and without locks.
+#[derive(Debug)]
+pub struct LatencyHistogram {
+    shards: Box<[OnceLock<HistogramShard>]>,
+}
+
+/// One thread's buckets, with the count and sum in microseconds
+#[derive(Debug)]
+#[repr(align(128))]
+struct HistogramShard {
+    count: AtomicU64,
+    sum: AtomicU64,
+    buckets: Box<[AtomicU64]>,
+}
+
+impl HistogramShard {
+    fn new() -> Self {
+        Self {
+            count: AtomicU64::new(0),
+            sum: AtomicU64::new(0),
+            buckets: (0..BUCKETS).map(|_| AtomicU64::new(0)).collect(),
+        }
+    }
+}
+
+impl Default for LatencyHistogram {
+    fn default() -> Self {
+        Self {
+            shards: (0..SHARDS).map(|_| OnceLock::new()).collect(),
+        }
+    }
+}
+
+impl LatencyHistogram {
+    pub fn new() -> Self {
+        Self::default()
+    }
+    
+    fn bucket_index(micros: u64) -> usize {
+        if micros < LINEAR_BUCKETS as u64 {
+            return micros as usize;
+        }
+        let msb = (63 - micros.leading_zeros()).min(MAX_VALUE_BIT);
+        let shift = msb - SUB_BUCKET_BITS;
+        let mantissa = ((micros >> shift) as usize).min(2 * SUB_BUCKETS - 1);
+        LINEAR_BUCKETS + (shift as usize - 1) * SUB_BUCKETS + (mantissa - SUB_BUCKETS)
+    }
+    
+    /// Largest value (in microseconds) that falls into bucket `index`
+    fn bucket_upper_bound(index: usize) -> u64 {
+        if index < LINEAR_BUCKETS {
+            return index as u64;
+        }
+        let shift = ((index - LINEAR_BUCKETS) / SUB_BUCKETS + 1) as u32;
+        let mantissa = ((index - LINEAR_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS) as u64;
+        ((mantissa + 1) << shift) - 1
+    }
+    
+    /// Record one duration
+    pub fn record(&self, duration: Duration) {
+        let micros = u64::try_from(duration.as_micros()).unwrap_or(u64::MAX);
+        let shard = self.shards[shard_index()].get_or_init(HistogramShard::new);
+        shard.buckets[Self::bucket_index(micros)].fetch_add(1, Ordering::Relaxed);
+        shard.count.fetch_add(1, Ordering::Relaxed);
+        shard.sum.fetch_add(micros, Ordering::Relaxed);
+    }
+    
+    /// Take a percentile snapshot
+    ///
+    /// Concurrent recordings may or may not be included.
+    pub fn summary(&self) -> LatencySummary {
+        let mut counts = vec![0u64; BUCKETS];
+        let mut recorded = 0u64;
+        let mut sum = 0u64;
+        for shard in self.shards.iter().filter_map(OnceLock::get) {
+            for (count, bucket) in counts.iter_mut().zip(shard.buckets.iter()) {
+                *count += bucket.load(Ordering::Relaxed);
+            }
+            recorded += shard.count.load(Ordering::Relaxed);
+            sum += shard.sum.load(Ordering::Relaxed);
+        }
+        let count: u64 = counts.iter().sum();
+        if count == 0 {
+            return LatencySummary::default();
+        }
+        
+        let percentile = |p: f64| {
+            let rank = ((p * count as f64).ceil() as u64).max(1);
+            let mut seen = 0;
+            for (index, &n) in counts.iter().enumerate() {
+                seen += n;
+                if seen >= rank {
+                    return Duration::from_micros(Self::bucket_upper_bound(index));
+                }
+            }
+            Duration::ZERO
+        };
+        
+        LatencySummary {
+            count,
+            sum: Duration::from_micros(sum),
+            mean: Duration::from_micros(sum / recorded.max(1)),
+            p50: percentile(0.50),
+            p90: percentile(0.90),
+            p99: percentile(0.99),
+            p999: percentile(0.999),
+            max: percentile(1.0),
+        }
+    }
+}
+
+/// Number of domains tracked by default
+pub const DEFAULT_TRACKED_DOMAINS: usize = 64;
+
+/// Counters and latency for one tracked domain
+#[derive(Debug, Clone)]
+pub struct DomainStats {
+    pub domain: String,
+    /// Lookups counted for the domain; may overcount by up to `lookups_error`
+    pub lookups: u64,
+    /// Lookups inherited from the domain this one replaced
+    pub lookups_error: u64,
+    /// Failures since the domain was last admitted
+    pub failures: u64,
+    /// Mean latency of successful lookups since the domain was last admitted
+    pub mean_latency: Duration,
+    pub max_latency: Duration,
+}
+
+#[derive(Debug, Clone)]
+struct DomainSlot {
+    domain: Arc<str>,
+    lookups: u64,
+    lookups_error: u64,
+    failures: u64,
+    successes: u64,
+    total_latency: Duration,
+    max_latency: Duration,
+}
+
+/// Fixed-size heavy-hitter tables of domains (space-saving algorithm)
+///
+/// Each thread's shard keeps at most `capacity` domains. An untracked domain
+/// replaces the one with the fewest lookups and inherits its count as an
+/// overestimate, so any domain with more than total/capacity of a shard's
+/// lookups is present in that shard. Shards are merged when read.
+#[derive(Debug)]
+struct DomainTracker {
+    capacity: usize,
+    shards: Box<[DomainShard]>,
+}
+
+#[derive(Debug, Default)]
+#[repr(align(128))]
+struct DomainShard(Mutex<DomainTable>);
+
+/// Slots kept as a binary min-heap on lookups, so the slot to evict is the root
+#[derive(Debug, Default)]
+struct DomainTable {
+    slots: Vec<DomainSlot>,
+    /// Heap position of each domain
+    index: HashMap<Arc<str>, usize>,
+}
+
+impl Default for DomainTracker {
+    fn default() -> Self {
+        Self::new(DEFAULT_TRACKED_DOMAINS)
+    }
+}
+
+impl DomainTracker {
+    fn new(capacity: usize) -> Self {
+        Self {
+            capacity: capacity.max(1),
+            shards: (0..SHARDS).map(|_| DomainShard::default()).collect(),
+        }
+    }
+    
+    /// Count one lookup for `domain` and update its slot
+    ///
+    /// Only tries the calling thread's shard lock and returns false, dropping
+    /// the sample, if another thread sharing the shard or a reader holds it.
+    /// Admitting a domain makes one allocation and eviction is O(log capacity).
+    fn record(&self, domain: &str, update: impl FnOnce(&mut DomainSlot)) -> bool {
+        let mut table = match self.shards[shard_index()].0.try_lock() {
+            Ok(table) => table,
+            Err(TryLockError::Poisoned(poisoned)) => poisoned.into_inner(),
+            Err(TryLockError::WouldBlock) => return false,
+        };
+        let table = &mut *table;
+        
+        let pos = match table.index.get(domain) {
+            Some(&pos) => pos,
+            None if table.slots.len() < self.capacity => {
+                let domain: Arc<str> = domain.into();
+                table.index.insert(domain.clone(), table.slots.len());
+                table.slots.push(DomainSlot::new(domain, 0));
+                table.sift_up(table.slots.len() - 1)
+            },
+            None => {
+                let evicted = table.slots[0].lookups;
+                table.index.remove(&table.slots[0].domain);
+                let domain: Arc<str> = domain.into();
+                table.index.insert(domain.clone(), 0);
+                table.slots[0] = DomainSlot::new(domain, evicted);
+                0
+            },
+        };
+        
+        let slot = &mut table.slots[pos];
+        slot.lookups += 1;
+        update(slot);
+        table.sift_down(pos);
+        true
+    }
+    
+    /// Tracked domains ordered by `key`, largest first
+    ///
+    /// Counts of a domain tracked by several shards are added up, and the
+    /// `capacity` domains with the most lookups are kept.
+    fn top<K: Ord>(&self, n: usize, key: impl Fn(&DomainStats) -> K) -> Vec<DomainStats> {
+        let mut merged: HashMap<Arc<str>, DomainSlot> = HashMap::new();
+        for shard in self.shards.iter() {
+            let table = shard.0.lock().unwrap_or_else(PoisonError::into_inner);
+            for slot in &table.slots {
+                merged.entry(slot.domain.clone())
+                    .and_modify(|merged| merged.merge(slot))
+                    .or_insert_with(|| slot.clone());
+            }
+        }
+        
+        let mut stats: Vec<DomainStats> = merged.values().map(DomainSlot::stats).collect();
+        stats.sort_by(|a, b| b.lookups.cmp(&a.lookups));
+        stats.truncate(self.capacity);
+        stats.sort_by(|a, b| key(b).cmp(&key(a)));
+        stats.truncate(n);
+        stats
+    }
+}
+
+impl DomainTable {
+    /// Move the slot at `pos` towards the root while its parent has more lookups
+    fn sift_up(&mut self, mut pos: usize) -> usize {
+        while pos > 0 {
+            let parent = (pos - 1) / 2;
+            if self.slots[parent].lookups <= self.slots[pos].lookups {
+                break;
+            }
+            self.swap(pos, parent);
+            pos = parent;
+        }
+        pos
+    }
+    
+    /// Move the slot at `pos` away from the root while a child has fewer lookups
+    fn sift_down(&mut self, mut pos: usize) {
+        loop {
+            let mut smallest = pos;
+            for child in [2 * pos + 1, 2 * pos + 2] {
+                if child < self.slots.len() && self.slots[child].lookups < self.slots[smallest].lookups {
+                    smallest = child;
+                }
+            }
+            if smallest == pos {
+                return;
+            }
+            self.swap(pos, smallest);
+            pos = smallest;
+        }
+    }
+    
+    fn swap(&mut self, a: usize, b: usize) {
+        self.slots.swap(a, b);
+        for pos in [a, b] {
+            if let Some(index) = self.index.get_mut(&self.slots[pos].domain) {
+                *index = pos;
+            }
+        }
+    }
+}
+
+impl DomainSlot {
+    /// Slot for a newly admitted domain, inheriting `lookups` from the evicted one
+    fn new(domain: Arc<str>, lookups: u64) -> Self {
+        Self {
+            domain,
+            lookups,
+            lookups_error: lookups,
+            failures: 0,
+            successes: 0,
+            total_latency: Duration::ZERO,
+            max_latency: Duration::ZERO,
+        }
+    }
+    
+    /// Add the counts of another shard's slot for the same domain
+    fn merge(&mut self, other: &DomainSlot) {
+        self.lookups += other.lookups;
+        self.lookups_error += other.lookups_error;
+        self.failures += other.failures;
+        self.successes += other.successes;
+        self.total_latency += other.total_latency;
+        self.max_latency = self.max_latency.max(other.max_latency);
+    }
+    
+    fn stats(&self) -> DomainStats {
+        DomainStats {
+            domain: self.domain.to_string(),
+            lookups: self.lookups,
+            lookups_error: self.lookups_error,
+            failures: self.failures,
+            mean_latency: if self.successes > 0 {
+                Duration::from_nanos((self.total_latency.as_nanos() / u128::from(self.successes)) as u64)
+            } else {
+                Duration::ZERO
+            },
+            max_latency: self.max_latency,
+        }
+    }
+}
+
 impl Bip353Metrics {
     pub fn new() -> Self {
         Self::default()
     }
     
+    /// Create metrics tracking up to `tracked_domains` domains
+    pub fn with_domain_capacity(tracked_domains: usize) -> Self {
+        Self {
+            domains: DomainTracker::new(tracked_domains),
+            ..Self::default()
+        }
+    }
+    
     /// Record a successful resolution
-    pub async fn record_resolution_success(&self, _domain: &str, _duration: Duration) {
-        self.resolutions_total.fetch_add(1, Ordering::Relaxed);
-        self.resolutions_success.fetch_add(1, Ordering::Relaxed);
+    pub fn record_resolution_success(&self, domain: &str, duration: Duration) {
+        let shard = self.counters.shard();
+        shard.0[RESOLUTIONS_TOTAL].fetch_add(1, Ordering::Relaxed);
+        shard.0[RESOLUTIONS_SUCCESS].fetch_add(1, Ordering::Relaxed);
+        self.miss_latency.record(duration);
+        let recorded = self.domains.record(domain, |slot| {
+            slot.successes += 1;
+            slot.total_latency += duration;
+            slot.max_latency = slot.max_latency.max(duration);
+        });
+        if !recorded {
+            shard.0[DOMAIN_SAMPLES_DROPPED].fetch_add(1, Ordering::Relaxed);
+        }
     }
     
     /// Record a failed resolution
-    pub async fn record_resolution_failure(&self, _domain: &str, _error_type: &str) {
-        self.resolutions_total.fetch_add(1, Ordering::Relaxed);
-        self.resolutions_failed.fetch_add(1, Ordering::Relaxed);
+    pub fn record_resolution_failure(&self, domain: &str, kind: ErrorKind) {
+        self.record_failure(kind);
+        if !self.domains.record(domain, |slot| slot.failures += 1) {
+            self.counters.add(DOMAIN_SAMPLES_DROPPED, 1);
+        }
+    }
+    
+    /// Record a failure not attributable to a domain (e.g. a malformed address)
+    pub fn record_failure(&self, kind: ErrorKind) {
+        let shard = self.counters.shard();
+        shard.0[RESOLUTIONS_TOTAL].fetch_add(1, Ordering::Relaxed);
+        shard.0[RESOLUTIONS_FAILED].fetch_add(1, Ordering::Relaxed);
+        shard.0[FAILURES_BY_KIND + kind as usize].fetch_add(1, Ordering::Relaxed);
+    }
+    
+    /// Record the latency of a resolution
+    ///
+    /// `record_resolution_success` already records a cache miss.
+    pub fn record_latency(&self, outcome: LatencyOutcome, duration: Duration) {
+        match outcome {
+            LatencyOutcome::CacheHit => self.hit_latency.record(duration),
+            LatencyOutcome::CacheMiss => self.miss_latency.record(duration),
+            LatencyOutcome::Error => self.error_latency.record(duration),
+        }
     }
     
     /// Record cache hit
     pub fn record_cache_hit(&self) {
-        self.cache_hits.fetch_add(1, Ordering::Relaxed);
+        self.counters.add(CACHE_HITS, 1);
     }
     
     /// Record cache miss
     pub fn record_cache_miss(&self) {
-        self.cache_misses.fetch_add(1, Ordering::Relaxed);
+        self.counters.add(CACHE_MISSES, 1);
     }
     
     /// Record address reuse detection
     pub fn record_address_reuse(&self) {
-        self.address_reuse_detected.fetch_add(1, Ordering::Relaxed);
+        self.counters.add(ADDRESS_REUSE_DETECTED, 1);
     }
     
     /// Get resolution statistics
     pub fn get_resolution_stats(&self) -> ResolutionStats {
-        let total = self.resolutions_total.load(Ordering::Relaxed);
-        let success = self.resolutions_success.load(Ordering::Relaxed);
-        let failed = self.resolutions_failed.load(Ordering::Relaxed);
+        let total = self.counters.get(RESOLUTIONS_TOTAL);
+        let success = self.counters.get(RESOLUTIONS_SUCCESS);
+        let failed = self.counters.get(RESOLUTIONS_FAILED);
         
         ResolutionStats {
             total,
@@ -76,10 +569,53 @@ impl Bip353Metrics {
         }
     }
     
+    /// Get the number of resolved addresses detected in use on chain
+    pub fn get_address_reuse_count(&self) -> u64 {
+        self.counters.get(ADDRESS_REUSE_DETECTED)
+    }
+    
+    /// Get the number of resolutions left out of the domain tables under contention
+    pub fn get_dropped_domain_samples(&self) -> u64 {
+        self.counters.get(DOMAIN_SAMPLES_DROPPED)
+    }
+    
+    /// Get latency percentiles by outcome
+    pub fn get_latency_stats(&self) -> LatencyStats {
+        LatencyStats {
+            cache_hit: self.hit_latency.summary(),
+            cache_miss: self.miss_latency.summary(),
+            error: self.error_latency.summary(),
+        }
+    }
+    
+    /// Get failure counts by error kind
+    pub fn get_failure_stats(&self) -> FailureStats {
+        FailureStats {
+            counts: ErrorKind::ALL.iter()
+                .map(|&kind| (kind, self.counters.get(FAILURES_BY_KIND + kind as usize)))
+                .collect(),
+        }
+    }
+    
+    /// Get the `n` tracked domains with the highest mean latency
+    pub fn top_slow_domains(&self, n: usize) -> Vec<DomainStats> {
+        self.domains.top(n, |d| d.mean_latency)
+    }
+    
+    /// Get the `n` tracked domains with the most failures
+    pub fn top_failing_domains(&self, n: usize) -> Vec<DomainStats> {
+        self.domains.top(n, |d| d.failures)
+    }
+    
+    /// Get the `n` tracked domains with the most lookups
+    pub fn top_domains(&self, n: usize) -> Vec<DomainStats> {
+        self.domains.top(n, |d| d.lookups)
+    }
+    
     /// Get cache statistics
     pub fn get_cache_stats(&self) -> CacheStats {
-        let hits = self.cache_hits.load(Ordering::Relaxed);
-        let misses = self.cache_misses.load(Ordering::Relaxed);
+        let hits = self.counters.get(CACHE_HITS);
+        let misses = self.counters.get(CACHE_MISSES);
         let total = hits + misses;
         
         CacheStats {
@@ -89,4 +625,176 @@ impl Bip353Metrics {
             hit_rate: if total > 0 { (hits as f64) / (total as f64) } else { 0.0 },
         }
     }
-}
\ No newline at end of file
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    
+    #[test]
+    fn test_bucket_bounds() {
+        // Every value lands in a bucket whose upper bound covers it within ~3%
+        for micros in [0, 1, 63, 64, 65, 127, 128, 1_000, 12_345, 5_000_000, 1 << 38] {
+            let index = LatencyHistogram::bucket_index(micros);
+            let upper = LatencyHistogram::bucket_upper_bound(index);
+            assert!(upper >= micros, "{} -> {}", micros, upper);
+            assert!(upper - micros <= micros / 32, "{} -> {}", micros, upper);
+        }
+        assert_eq!(LatencyHistogram::bucket_index(u64::MAX), BUCKETS - 1);
+    }
+    
+    #[test]
+    fn test_domain_tracking_is_bounded() {
+        let metrics = Bip353Metrics::with_domain_capacity(4);
+        
+        // One heavy, slow and failing domain among many one-off domains
+        for i in 0..100 {
+            metrics.record_resolution_success(&format!("d{}.example", i), Duration::from_millis(1));
+            metrics.record_resolution_success("slow.example", Duration::from_millis(500));
+            if i % 2 == 0 {
+                metrics.record_resolution_failure("slow.example", ErrorKind::Timeout);
+            }
+        }
+        
+        assert_eq!(metrics.top_domains(usize::MAX).len(), 4);
+        assert_eq!(metrics.top_domains(1)[0].domain, "slow.example");
+        assert_eq!(metrics.top_failing_domains(1)[0].failures, 50);
+        assert_eq!(metrics.get_resolution_stats().failed, 50);
+        assert_eq!(metrics.get_failure_stats().get(ErrorKind::Timeout), 50);
+        assert_eq!(metrics.get_failure_stats().get(ErrorKind::Dns), 0);
+        
+        let slow = &metrics.top_slow_domains(1)[0];
+        assert_eq!(slow.domain, "slow.example");
+        assert_eq!(slow.mean_latency, Duration::from_millis(500));
+    }
+    
+    #[test]
+    fn test_domain_mean_latency_with_large_counts() {
+        let mut slot = DomainSlot::new("busy.example".into(), 0);
+        slot.successes = 1 << 32;
+        slot.total_latency = Duration::from_micros(3) * (1 << 31) * 2;
+        assert_eq!(slot.stats().mean_latency, Duration::from_micros(3));
+        
+        slot.successes = 0;
+        assert_eq!(slot.stats().mean_latency, Duration::ZERO);
+    }
+    
+    #[test]
+    fn test_domain_recording_never_waits() {
+        let metrics = Bip353Metrics::new();
+        
+        // A held shard drops the domain sample but still counts the resolution
+        let shard = metrics.domains.shards[shard_index()].0.lock().unwrap();
+        metrics.record_resolution_success("busy.example", Duration::from_millis(1));
+        metrics.record_resolution_failure("busy.example", ErrorKind::Dns);
+        drop(shard);
+        
+        assert_eq!(metrics.get_dropped_domain_samples(), 2);
+        assert_eq!(metrics.get_resolution_stats().total, 2);
+        assert!(metrics.top_domains(usize::MAX).is_empty());
+        
+        metrics.record_resolution_success("busy.example", Duration::from_millis(1));
+        assert_eq!(metrics.top_domains(1)[0].lookups, 1);
+        assert_eq!(metrics.get_dropped_domain_samples(), 2);
+    }
+    
+    #[test]
+    fn test_domain_eviction_keeps_heavy_domains() {
+        let metrics = Bip353Metrics::with_domain_capacity(8);
+        
+        // Domains above 1/8 of the lookups among a stream of one-off domains
+        for i in 0..10_000 {
+            metrics.record_resolution_success(&format!("once{}.example", i), Duration::from_millis(1));
+            if i % 2 == 0 {
+                metrics.record_resolution_success("heavy.example", Duration::from_millis(1));
+            }
+            if i % 4 == 0 {
+                metrics.record_resolution_success("medium.example", Duration::from_millis(1));
+            }
+        }
+        
+        let top = metrics.top_domains(2);
+        assert_eq!(top[0].domain, "heavy.example");
+        assert_eq!(top[1].domain, "medium.example");
+        // Overestimated by at most the inherited count
+        assert!(top[0].lookups >= 5000 && top[0].lookups - top[0].lookups_error <= 5000);
+    }
+    
+    #[test]
+    fn test_domain_shards_merge_across_threads() {
+        let metrics = Arc::new(Bip353Metrics::with_domain_capacity(4));
+        let threads: Vec<_> = (0..8).map(|i| {
+            let metrics = metrics.clone();
+            std::thread::spawn(move || {
+                for _ in 0..100 {
+                    metrics.record_resolution_success("shared.example", Duration::from_millis(2));
+                    metrics.record_resolution_failure(&format!("thread{}.example", i), ErrorKind::Dns);
+                }
+            })
+        }).collect();
+        for thread in threads {
+            thread.join().unwrap();
+        }
+        
+        let top = metrics.top_domains(usize::MAX);
+        assert_eq!(top.len(), 4);
+        assert_eq!(top[0].domain, "shared.example");
+        assert_eq!(top[0].lookups, 800);
+        assert_eq!(top[0].mean_latency, Duration::from_millis(2));
+    }
+    
+    #[test]
+    fn test_sharded_counters_sum_across_threads() {
+        let metrics = Arc::new(Bip353Metrics::new());
+        let threads: Vec<_> = (0..8).map(|_| {
+            let metrics = metrics.clone();
+            std::thread::spawn(move || {
+                for _ in 0..1000 {
+                    metrics.record_cache_hit();
+                }
+            })
+        }).collect();
+        for thread in threads {
+            thread.join().unwrap();
+        }
+        assert_eq!(metrics.get_cache_stats().hits, 8000);
+    }
+    
+    #[test]
+    fn test_histogram_shards_sum_across_threads() {
+        let histogram = Arc::new(LatencyHistogram::new());
+        let threads: Vec<_> = (0..8u64).map(|i| {
+            let histogram = histogram.clone();
+            std::thread::spawn(move || {
+                for _ in 0..1000 {
+                    histogram.record(Duration::from_micros(100 * (i + 1)));
+                }
+            })
+        }).collect();
+        for thread in threads {
+            thread.join().unwrap();
+        }
+        
+        let summary = histogram.summary();
+        assert_eq!(summary.count, 8000);
+        assert_eq!(summary.sum, Duration::from_micros(100 * 1000 * (1..=8).sum::<u64>()));
+        assert_eq!(summary.p50.as_micros() / 100, 4);
+        assert_eq!(summary.max.as_micros() / 100, 8);
+    }
+    
+    #[test]
+    fn test_percentiles() {
+        let histogram = LatencyHistogram::new();
+        for ms in 1..=1000 {
+            histogram.record(Duration::from_millis(ms));
+        }
+        
+        let summary = histogram.summary();
+        assert_eq!(summary.count, 1000);
+        let close = |d: Duration, ms: u64| (d.as_millis() as i64 - ms as i64).abs() as u64 <= ms / 30 + 1;
+        assert!(close(summary.p50, 500), "{:?}", summary.p50);
+        assert!(close(summary.p90, 900), "{:?}", summary.p90);
+        assert!(close(summary.p99, 990), "{:?}", summary.p99);
+        assert!(close(summary.max, 1000), "{:?}", summary.max);
+    }
+}
@@ -0,0 +1,629 @@
+//! Resolution middleware
+//!
+//! Every resolution runs through a stack of layers around the core lookup,
+//! in the style of tower: a `Layer` wraps an inner `Resolve` service and
+//! `Stack` makes it optional. A disabled layer is a `None` checked once per
+//! call, so a deployment only pays for the layers it enables.
+
+use futures::future::Either;
+use std::collections::{HashMap, HashSet, VecDeque};
+use std::future::Future;
+use std::sync::{Arc, Mutex, PoisonError, RwLock};
+use std::time::{Duration, Instant, SystemTime};
+use tokio::sync::broadcast;
+
+use crate::{
+    Bip353Error,
+    alloc_profile::{self, AllocStage},
+    config::{RateLimit, RetryPolicy},
+    metrics::{Bip353Metrics, LatencyOutcome},
+    report::ReportCollector,
+    trace,
+    types::PaymentInfo,
+    usdt,
+};
+
+/// Outcome of a resolution
+pub type ResolveResult = Result<PaymentInfo, Bip353Error>;
+
+/// A name to resolve, formatted once as "user@domain"
+#[derive(Debug)]
+pub struct Lookup {
+    hrn: String,
+    separator: usize,
+    report: Option<Box<ReportCollector>>,
+}
+
+impl Lookup {
+    pub fn new(user: &str, domain: &str) -> Self {
+        Self {
+            hrn: format!("{}@{}", user, domain),
+            separator: user.len(),
+            report: None,
+        }
+    }
+    
+    /// Collect a `ResolutionReport` while the lookup runs
+    pub(crate) fn with_report(mut self) -> Self {
+        self.report = Some(Box::default());
+        self
+    }
+    
+    pub(crate) fn report(&self) -> Option<&ReportCollector> {
+        self.report.as_deref()
+    }
+    
+    /// The name as "user@domain"
+    pub fn hrn(&self) -> &str {
+        &self.hrn
+    }
+    
+    pub fn user(&self) -> &str {
+        &self.hrn[..self.separator]
+    }
+    
+    pub fn domain(&self) -> &str {
+        &self.hrn[self.separator + 1..]
+    }
+}
+
+/// A resolution service: the core lookup, or a stack of layers over it
+pub trait Resolve: Send + Sync {
+    fn resolve<'a>(&'a self, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a;
+}
+
+/// Middleware around an inner resolution service
+pub trait Layer<S: Resolve>: Send + Sync {
+    fn call<'a>(&'a self, inner: &'a S, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a;
+}
+
+/// An optional layer over an inner service
+pub struct Stack<L, S> {
+    layer: Option<L>,
+    inner: S,
+}
+
+impl<L, S> Stack<L, S> {
+    pub fn new(layer: Option<L>, inner: S) -> Self {
+        Self { layer, inner }
+    }
+}
+
+impl<L: Layer<S>, S: Resolve> Resolve for Stack<L, S> {
+    fn resolve<'a>(&'a self, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+        match &self.layer {
+            Some(layer) => Either::Left(layer.call(&self.inner, lookup)),
+            None => Either::Right(self.inner.resolve(lookup)),
+        }
+    }
+}
+
+/// Simple address cache with TTL
+#[derive(Debug)]
+pub(crate) struct AddressCache {
+    entries: RwLock<CacheEntries>,
+    default_ttl: Duration,
+    max_entries: usize,
+    /// Names with a background fill running
+    fills: Mutex<HashSet<String>>,
+}
+
+/// Result of `AddressCache::lookup`
+pub(crate) enum CacheLookup {
+    Fresh(PaymentInfo, Duration),
+    Expired,
+    Missing,
+}
+
+#[derive(Debug, Clone)]
+struct CacheEntry {
+    payment_info: PaymentInfo,
+    cached_at: SystemTime,
+    ttl: Duration,
+    /// Matches the entry's position in `CacheEntries::order`
+    generation: u64,
+}
+
+/// Entries by name, and their names in insertion order
+///
+/// Every entry has the cache's TTL, so insertion order is also expiry order
+/// and the front of `order` is always the next entry to evict. Replaced and
+/// invalidated entries leave stale positions behind; they are skipped when
+/// reached and compacted away once they outnumber the entries.
+#[derive(Debug, Default)]
+struct CacheEntries {
+    map: HashMap<Arc<str>, CacheEntry>,
+    order: VecDeque<(Arc<str>, u64)>,
+    next_generation: u64,
+}
+
+impl CacheEntries {
+    /// Remove the oldest entry, or only expired ones when `expired_only` is set
+    fn evict_front(&mut self, expired_only: bool) -> bool {
+        while let Some((hrn, generation)) = self.order.front() {
+            let current = self.map.get(hrn).filter(|entry| entry.generation == *generation);
+            if let Some(entry) = current {
+                if expired_only && entry.cached_at.elapsed().unwrap_or(Duration::MAX) < entry.ttl {
+                    return false;
+                }
+                self.map.remove(hrn);
+                self.order.pop_front();
+                return true;
+            }
+            self.order.pop_front();
+        }
+        false
+    }
+    
+    /// Drop stale positions once they outnumber the entries, keeping pushes amortized O(1)
+    fn compact(&mut self) {
+        if self.order.len() > 2 * self.map.len() + 16 {
+            let map = &self.map;
+            self.order.retain(|(hrn, generation)| map.get(hrn).is_some_and(|entry| entry.generation == *generation));
+        }
+    }
+}
+
+impl AddressCache {
+    pub(crate) fn new(default_ttl: Duration, max_entries: usize) -> Self {
+        Self {
+            entries: RwLock::new(CacheEntries::default()),
+            default_ttl,
+            max_entries,
+            fills: Mutex::new(HashSet::new()),
+        }
+    }
+    
+    // The lock is never held across an await, so a plain RwLock keeps lookups
+    // synchronous and usable outside the runtime.
+    
+    /// Run `f` on a fresh entry without cloning it
+    pub(crate) fn with_entry<T>(&self, hrn: &str, f: impl FnOnce(&PaymentInfo) -> T) -> Option<T> {
+        let _stage = alloc_profile::enter(AllocStage::Cache);
+        let entries = self.entries.read().unwrap_or_else(PoisonError::into_inner);
+        let entry = entries.map.get(hrn)?;
+        if entry.cached_at.elapsed().unwrap_or(Duration::MAX) < entry.ttl {
+            Some(f(&entry.payment_info))
+        } else {
+            None
+        }
+    }
+    
+    /// Fresh entry with its remaining TTL, or whether an expired one is present
+    pub(crate) fn lookup(&self, hrn: &str) -> CacheLookup {
+        let _stage = alloc_profile::enter(AllocStage::Cache);
+        let entries = self.entries.read().unwrap_or_else(PoisonError::into_inner);
+        let entry = match entries.map.get(hrn) {
+            Some(entry) => entry,
+            None => return CacheLookup::Missing,
+        };
+        match entry.ttl.checked_sub(entry.cached_at.elapsed().unwrap_or(Duration::MAX)) {
+            Some(remaining) if !remaining.is_zero() => CacheLookup::Fresh(entry.payment_info.clone(), remaining),
+            _ => CacheLookup::Expired,
+        }
+    }
+    
+    pub(crate) fn insert(&self, hrn: &str, payment_info: PaymentInfo) {
+        let mut entries = self.entries.write().unwrap_or_else(PoisonError::into_inner);
+        
+        // Drop expired entries from the front, then make room when bounded
+        while entries.evict_front(true) {}
+        if self.max_entries > 0 && entries.map.len() >= self.max_entries && !entries.map.contains_key(hrn) {
+            entries.evict_front(false);
+        }
+        
+        let hrn: Arc<str> = Arc::from(hrn);
+        let generation = entries.next_generation;
+        entries.next_generation += 1;
+        entries.order.push_back((hrn.clone(), generation));
+        entries.map.insert(hrn, CacheEntry {
+            payment_info,
+            cached_at: SystemTime::now(),
+            ttl: self.default_ttl,
+            generation,
+        });
+        entries.compact();
+    }
+    
+    /// Claim the background fill of `hrn`, None if one is already running
+    pub(crate) fn claim_fill(self: &Arc<Self>, hrn: &str) -> Option<FillClaim> {
+        let mut fills = self.fills.lock().unwrap_or_else(PoisonError::into_inner);
+        if fills.contains(hrn) {
+            return None;
+        }
+        fills.insert(hrn.to_string());
+        Some(FillClaim { cache: self.clone(), hrn: hrn.to_string() })
+    }
+    
+    pub(crate) fn invalidate(&self, hrn: &str) {
+        let mut entries = self.entries.write().unwrap_or_else(PoisonError::into_inner);
+        entries.map.remove(hrn);
+        entries.compact();
+    }
+    
+    pub(crate) fn clear(&self) {
+        let mut entries = self.entries.write().unwrap_or_else(PoisonError::into_inner);
+        entries.map.clear();
+        entries.order.clear();
+    }
+    
+    /// Number of stored entries, including expired ones not yet evicted
+    pub(crate) fn len(&self) -> usize {
+        self.entries.read().unwrap_or_else(PoisonError::into_inner).map.len()
+    }
+    
+    /// Positions in the eviction order, including stale ones
+    #[cfg(test)]
+    pub(crate) fn order_len(&self) -> usize {
+        self.entries.read().unwrap_or_else(PoisonError::into_inner).order.len()
+    }
+}
+
+/// A running background fill, released on drop
+pub(crate) struct FillClaim {
+    cache: Arc<AddressCache>,
+    hrn: String,
+}
+
+impl Drop for FillClaim {
+    fn drop(&mut self) {
+        self.cache.fills.lock().unwrap_or_else(PoisonError::into_inner).remove(&self.hrn);
+    }
+}
+
+/// Serve fresh results from the address cache and store successful lookups
+pub struct CacheLayer {
+    cache: Arc<AddressCache>,
+    metrics: Option<Arc<Bip353Metrics>>,
+}
+
+impl CacheLayer {
+    pub(crate) fn new(cache: Arc<AddressCache>, metrics: Option<Arc<Bip353Metrics>>) -> Self {
+        Self { cache, metrics }
+    }
+    
+    /// A layer with its own cache of up to `max_entries` (0 = unbounded), without metrics
+    pub fn with_capacity(ttl: Duration, max_entries: usize) -> Self {
+        Self::new(Arc::new(AddressCache::new(ttl, max_entries)), None)
+    }
+}
+
+impl<S: Resolve> Layer<S> for CacheLayer {
+    fn call<'a>(&'a self, inner: &'a S, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+        async move {
+            let start = Instant::now();
+            let stale = match self.cache.lookup(lookup.hrn()) {
+                CacheLookup::Fresh(cached, ttl_remaining) => {
+                    trace::record("cache", "hit");
+                    usdt::sdt!(cache__hit, lookup.hrn().len(), ttl_remaining.as_millis() as u64);
+                    if let Some(report) = lookup.report() {
+                        report.cache_hit(ttl_remaining);
+                    }
+                    if let Some(metrics) = &self.metrics {
+                        metrics.record_cache_hit();
+                        metrics.record_latency(LatencyOutcome::CacheHit, start.elapsed());
+                    }
+                    return Ok(cached);
+                },
+                CacheLookup::Expired => true,
+                CacheLookup::Missing => false,
+            };
+            trace::record("cache", "miss");
+            usdt::sdt!(cache__miss, lookup.hrn().len(), stale as u64);
+            if let Some(report) = lookup.report() {
+                report.cache_miss(stale);
+            }
+            if let Some(metrics) = &self.metrics {
+                metrics.record_cache_miss();
+            }
+            
+            let result = inner.resolve(lookup).await;
+            if let Ok(payment_info) = &result {
+                let _stage = alloc_profile::enter(AllocStage::Cache);
+                self.cache.insert(lookup.hrn(), payment_info.clone());
+                if let Some(report) = lookup.report() {
+                    report.set_ttl_remaining(self.cache.default_ttl);
+                }
+            }
+            result
+        }
+    }
+}
+
+/// Record the outcome and duration of each resolution
+pub struct MetricsLayer {
+    metrics: Arc<Bip353Metrics>,
+}
+
+impl MetricsLayer {
+    pub fn new(metrics: Arc<Bip353Metrics>) -> Self {
+        Self { metrics }
+    }
+}
+
+impl<S: Resolve> Layer<S> for MetricsLayer {
+    fn call<'a>(&'a self, inner: &'a S, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+        async move {
+            let start = Instant::now();
+            let result = inner.resolve(lookup).await;
+            match &result {
+                Ok(_) => self.metrics.record_resolution_success(lookup.domain(), start.elapsed()),
+                Err(err) => {
+                    self.metrics.record_latency(LatencyOutcome::Error, start.elapsed());
+                    self.metrics.record_resolution_failure(lookup.domain(), err.kind());
+                },
+            }
+            result
+        }
+    }
+}
+
+/// Coalesce concurrent lookups of the same name into a single inner call
+///
+/// The first caller resolves; the others wait for its result. If the first
+/// caller is dropped before finishing, the waiters resolve on their own.
+#[derive(Default)]
+pub struct SingleFlightLayer {
+    in_flight: Mutex<HashMap<String, broadcast::Sender<ResolveResult>>>,
+}
+
+impl SingleFlightLayer {
+    pub fn new() -> Self {
+        Self::default()
+    }
+}
+
+/// Removes a name from the in-flight map when its leader finishes or is dropped
+struct Flight<'a> {
+    in_flight: &'a Mutex<HashMap<String, broadcast::Sender<ResolveResult>>>,
+    hrn: &'a str,
+}
+
+impl Flight<'_> {
+    fn finish(self) -> Option<broadcast::Sender<ResolveResult>> {
+        let sender = self.in_flight.lock().unwrap_or_else(PoisonError::into_inner).remove(self.hrn);
+        std::mem::forget(self);
+        sender
+    }
+}
+
+impl Drop for Flight<'_> {
+    fn drop(&mut self) {
+        self.in_flight.lock().unwrap_or_else(PoisonError::into_inner).remove(self.hrn);
+    }
+}
+
+impl<S: Resolve> Layer<S> for SingleFlightLayer {
+    fn call<'a>(&'a self, inner: &'a S, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+        async move {
+            let waiter = {
+                let mut in_flight = self.in_flight.lock().unwrap_or_else(PoisonError::into_inner);
+                match in_flight.get(lookup.hrn()) {
+                    Some(sender) => Some(sender.subscribe()),
+                    None => {
+                        in_flight.insert(lookup.hrn().to_string(), broadcast::channel(1).0);
+                        None
+                    }
+                }
+            };
+            
+            if let Some(mut waiter) = waiter {
+                return match waiter.recv().await {
+                    Ok(result) => {
+                        if let Some(report) = lookup.report() {
+                            report.coalesced();
+                        }
+                        result
+                    },
+                    Err(_) => inner.resolve(lookup).await,
+                };
+            }
+            
+            let flight = Flight { in_flight: &self.in_flight, hrn: lookup.hrn() };
+            let result = inner.resolve(lookup).await;
+            if let Some(sender) = flight.finish() {
+                let _ = sender.send(result.clone());
+            }
+            result
+        }
+    }
+}
+
+/// Retry transient failures with exponential backoff
+pub struct RetryLayer {
+    policy: RetryPolicy,
+}
+
+impl RetryLayer {
+    pub fn new(policy: RetryPolicy) -> Self {
+        Self { policy }
+    }
+    
+    fn is_transient(err: &Bip353Error) -> bool {
+        matches!(
+            err,
+            Bip353Error::DnsError(_)
+                | Bip353Error::NetworkError(_)
+                | Bip353Error::Timeout(_)
+                | Bip353Error::RateLimited
+        )
+    }
+}
+
+impl<S: Resolve> Layer<S> for RetryLayer {
+    fn call<'a>(&'a self, inner: &'a S, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+        async move {
+            let mut backoff = self.policy.backoff;
+            let mut retries = 0;
+            loop {
+                match inner.resolve(lookup).await {
+                    Err(err) if retries < self.policy.max_retries && Self::is_transient(&err) => {
+                        tokio::time::sleep(backoff).await;
+                        backoff = backoff.saturating_mul(2);
+                        retries += 1;
+                    }
+                    result => return result,
+                }
+            }
+        }
+    }
+}
+
+/// Token-bucket limit on lookups reaching the inner service
+///
+/// Lookups over the limit fail immediately with `Bip353Error::RateLimited`.
+pub struct RateLimitLayer {
+    limit: RateLimit,
+    bucket: Mutex<(f64, Instant)>,
+}
+
+impl RateLimitLayer {
+    pub fn new(limit: RateLimit) -> Self {
+        Self {
+            limit,
+            bucket: Mutex::new((limit.burst as f64, Instant::now())),
+        }
+    }
+    
+    fn try_acquire(&self) -> bool {
+        let mut bucket = self.bucket.lock().unwrap_or_else(PoisonError::into_inner);
+        let (tokens, last_refill) = &mut *bucket;
+        
+        let now = Instant::now();
+        let refill = now.duration_since(*last_refill).as_secs_f64() * self.limit.per_second as f64;
+        *tokens = (*tokens + refill).min(self.limit.burst as f64);
+        *last_refill = now;
+        
+        if *tokens >= 1.0 {
+            *tokens -= 1.0;
+            true
+        } else {
+            false
+        }
+    }
+}
+
+impl<S: Resolve> Layer<S> for RateLimitLayer {
+    fn call<'a>(&'a self, inner: &'a S, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+        let allowed = self.try_acquire();
+        async move {
+            if !allowed {
+                return Err(Bip353Error::RateLimited);
+            }
+            inner.resolve(lookup).await
+        }
+    }
+}
+
+/// Fail lookups that take longer than a fixed timeout
+pub struct TimeoutLayer {
+    timeout: Duration,
+}
+
+impl TimeoutLayer {
+    pub fn new(timeout: Duration) -> Self {
+        Self { timeout }
+    }
+}
+
+impl<S: Resolve> Layer<S> for TimeoutLayer {
+    fn call<'a>(&'a self, inner: &'a S, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+        async move {
+            tokio::time::timeout(self.timeout, inner.resolve(lookup)).await
+                .unwrap_or_else(|_| Err(Bip353Error::Timeout(format!("no answer within {}ms", self.timeout.as_millis()))))
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    
+    /// Service that fails `failures` times, then keeps failing with InvalidRecord
+    struct Scripted {
+        calls: AtomicUsize,
+        failures: usize,
+        delay: Duration,
+    }
+    
+    impl Scripted {
+        fn new(failures: usize, delay: Duration) -> Self {
+            Self { calls: AtomicUsize::new(0), failures, delay }
+        }
+        
+        fn calls(&self) -> usize {
+            self.calls.load(Ordering::SeqCst)
+        }
+    }
+    
+    impl Resolve for Scripted {
+        fn resolve<'a>(&'a self, _lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+            async move {
+                let call = self.calls.fetch_add(1, Ordering::SeqCst);
+                tokio::time::sleep(self.delay).await;
+                if call < self.failures {
+                    Err(Bip353Error::NetworkError("unreachable".into()))
+                } else {
+                    Err(Bip353Error::InvalidRecord("no payment instructions".into()))
+                }
+            }
+        }
+    }
+    
+    #[test]
+    fn test_lookup_parts() {
+        let lookup = Lookup::new("alice", "example.com");
+        assert_eq!(lookup.hrn(), "alice@example.com");
+        assert_eq!(lookup.user(), "alice");
+        assert_eq!(lookup.domain(), "example.com");
+    }
+    
+    #[tokio::test]
+    async fn test_disabled_layer_passes_through() {
+        let stack = Stack::new(None::<RetryLayer>, Scripted::new(1, Duration::ZERO));
+        let result = stack.resolve(&Lookup::new("alice", "example.com")).await;
+        assert!(matches!(result, Err(Bip353Error::NetworkError(_))));
+        assert_eq!(stack.inner.calls(), 1);
+    }
+    
+    #[tokio::test]
+    async fn test_retry_stops_at_permanent_error() {
+        let policy = RetryPolicy { max_retries: 5, backoff: Duration::from_millis(1) };
+        let stack = Stack::new(Some(RetryLayer::new(policy)), Scripted::new(2, Duration::ZERO));
+        let result = stack.resolve(&Lookup::new("alice", "example.com")).await;
+        assert!(matches!(result, Err(Bip353Error::InvalidRecord(_))));
+        assert_eq!(stack.inner.calls(), 3);
+    }
+    
+    #[tokio::test]
+    async fn test_timeout() {
+        let stack = Stack::new(
+            Some(TimeoutLayer::new(Duration::from_millis(5))),
+            Scripted::new(0, Duration::from_secs(5)),
+        );
+        let result = stack.resolve(&Lookup::new("alice", "example.com")).await;
+        assert!(matches!(result, Err(Bip353Error::Timeout(_))));
+    }
+    
+    #[tokio::test]
+    async fn test_rate_limit() {
+        let limit = RateLimit { per_second: 1, burst: 2 };
+        let stack = Stack::new(Some(RateLimitLayer::new(limit)), Scripted::new(0, Duration::ZERO));
+        let lookup = Lookup::new("alice", "example.com");
+        for _ in 0..3 {
+            let _ = stack.resolve(&lookup).await;
+        }
+        assert!(matches!(stack.resolve(&lookup).await, Err(Bip353Error::RateLimited)));
+        assert_eq!(stack.inner.calls(), 2);
+    }
+    
+    #[tokio::test]
+    async fn test_single_flight_coalesces() {
+        let stack = Stack::new(Some(SingleFlightLayer::new()), Scripted::new(0, Duration::from_millis(20)));
+        let lookup = Lookup::new("alice", "example.com");
+        let results = futures::future::join_all((0..8).map(|_| stack.resolve(&lookup))).await;
+        assert!(results.iter().all(|r| matches!(r, Err(Bip353Error::InvalidRecord(_)))));
+        assert_eq!(stack.inner.calls(), 1);
+    }
+}
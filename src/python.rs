@@ -3,16 +3,24 @@
 //! These bindings provide a Python API for HWI integration.
 
 use pyo3::prelude::*;
-use pyo3::exceptions::{PyRuntimeError, PyValueError};
-use pyo3::types::PyDict;
+use pyo3::exceptions::{PyKeyError, PyRuntimeError, PyValueError};
+use pyo3::intern;
+use pyo3::sync::GILOnceCell;
+use pyo3::types::{PyDict, PyString};
+use pyo3::wrap_pyfunction;
+use std::net::SocketAddr;
+use std::sync::{Arc, OnceLock};
+use futures::future::{AbortHandle, Abortable, Aborted};
 use tokio::runtime::Runtime;
 
+use crate::runtime::{build_runtime, DEFAULT_THREAD_NAME_PREFIX, DEFAULT_WORKER_THREADS};
 use crate::{
     Bip353Error,
     Bip353Resolver,
     ResolverConfig,
     PaymentInfo,
     PaymentType,
+    ResolutionReport,
 };
 
 /// Convert a BIP-353 error to a Python exception
@@ -23,22 +31,61 @@ fn to_py_err(err: Bip353Error) -> PyErr {
     }
 }
 
+/// Default number of concurrent lookups for resolve_many
+const DEFAULT_BATCH_CONCURRENCY: usize = 16;
+
+// Runtime shared by every PyResolver, created by init_runtime or on first use
+static RUNTIME: OnceLock<Runtime> = OnceLock::new();
+
+fn get_runtime() -> &'static Runtime {
+    RUNTIME.get_or_init(|| {
+        build_runtime(DEFAULT_WORKER_THREADS, DEFAULT_THREAD_NAME_PREFIX, false)
+            .expect("Failed to create Tokio runtime")
+    })
+}
+
+/// Configure the runtime shared by all resolvers
+///
+/// Must be called before the first resolution; raises RuntimeError once the
+/// runtime is running.
+#[pyfunction]
+#[pyo3(signature = (worker_threads=DEFAULT_WORKER_THREADS, thread_name_prefix=DEFAULT_THREAD_NAME_PREFIX))]
+fn init_runtime(worker_threads: usize, thread_name_prefix: &str) -> PyResult<()> {
+    if RUNTIME.get().is_some() {
+        return Err(PyRuntimeError::new_err("Runtime already initialized"));
+    }
+    
+    let runtime = build_runtime(worker_threads, thread_name_prefix, false)
+        .map_err(|e| PyRuntimeError::new_err(e.to_string()))?;
+    RUNTIME.set(runtime)
+        .map_err(|_| PyRuntimeError::new_err("Runtime already initialized"))
+}
+
 /// Python wrapper for the resolver
 #[pyclass]
 pub struct PyResolver {
-    resolver: Bip353Resolver,
-    rt: Runtime,
+    resolver: Arc<Bip353Resolver>,
 }
 
 #[pymethods]
 impl PyResolver {
     /// Create a new resolver
+    ///
+    /// `dns_resolver` optionally overrides the DNS server ("ip:port");
+    /// `enable_metrics` turns on metrics collection (see `get_metrics`).
     #[new]
-    fn new() -> PyResult<Self> {
-        let resolver = Bip353Resolver::new().map_err(|e| PyRuntimeError::new_err(e.to_string()))?;
-        let rt = Runtime::new().map_err(|e| PyRuntimeError::new_err(e.to_string()))?;
+    #[pyo3(signature = (dns_resolver=None, enable_metrics=false))]
+    fn new(dns_resolver: Option<&str>, enable_metrics: bool) -> PyResult<Self> {
+        let mut config = ResolverConfig::default().with_metrics(enable_metrics);
+        if let Some(dns_resolver) = dns_resolver {
+            let addr = dns_resolver.parse::<SocketAddr>()
+                .map_err(|e| PyValueError::new_err(format!("Invalid DNS resolver {}: {}", dns_resolver, e)))?;
+            config = config.with_dns_resolver(addr);
+        }
         
-        Ok(Self { resolver, rt })
+        let resolver = Bip353Resolver::with_config(config).map_err(|e| PyRuntimeError::new_err(e.to_string()))?;
+        
+        Ok(Self { resolver: Arc::new(resolver) })
     }
     
     /// Create a new resolver with a specific network
@@ -54,25 +101,114 @@ impl PyResolver {
         
         let resolver = Bip353Resolver::with_config(config)
             .map_err(|e| PyRuntimeError::new_err(e.to_string()))?;
-        let rt = Runtime::new().map_err(|e| PyRuntimeError::new_err(e.to_string()))?;
         
-        Ok(Self { resolver, rt })
+        Ok(Self { resolver: Arc::new(resolver) })
     }
     
     /// Resolve a human-readable Bitcoin address
-    fn resolve_address(&self, address: &str) -> PyResult<PyPaymentInfo> {
-        let instruction = self.rt.block_on(self.resolver.resolve_address(address))
+    ///
+    /// The GIL is released while the lookup is in flight.
+    fn resolve_address(&self, py: Python<'_>, address: &str) -> PyResult<PyPaymentInfo> {
+        let instruction = py.allow_threads(|| get_runtime().block_on(self.resolver.resolve_address(address)))
             .map_err(to_py_err)?;
         
-        Ok(PyPaymentInfo { instruction })
+        Ok(PyPaymentInfo::from(instruction))
     }
     
     /// Resolve a user@domain combination
-    fn resolve(&self, user: &str, domain: &str) -> PyResult<PyPaymentInfo> {
-        let instruction = self.rt.block_on(self.resolver.resolve(user, domain))
+    ///
+    /// The GIL is released while the lookup is in flight.
+    fn resolve(&self, py: Python<'_>, user: &str, domain: &str) -> PyResult<PyPaymentInfo> {
+        let instruction = py.allow_threads(|| get_runtime().block_on(self.resolver.resolve(user, domain)))
             .map_err(to_py_err)?;
         
-        Ok(PyPaymentInfo { instruction })
+        Ok(PyPaymentInfo::from(instruction))
+    }
+    
+    /// Resolve a human-readable Bitcoin address and report how it was answered
+    ///
+    /// Returns `(result, report)` where `result` is a PyPaymentInfo or the
+    /// exception, and `report` a dict with the cache status, upstream, RTT,
+    /// query and byte counts, timings in seconds and remaining TTL.
+    fn resolve_with_report(&self, py: Python<'_>, address: &str) -> PyResult<(PyObject, PyObject)> {
+        let (result, report) = py.allow_threads(|| {
+            get_runtime().block_on(self.resolver.resolve_address_with_report(address))
+        });
+        
+        let result = match result {
+            Ok(instruction) => Py::new(py, PyPaymentInfo::from(instruction))?.into_py(py),
+            Err(err) => to_py_err(err).into_value(py).into_py(py),
+        };
+        Ok((result, report_dict(py, &report)?.into_py(py)))
+    }
+    
+    /// Resolve a list of human-readable Bitcoin addresses
+    ///
+    /// The GIL is released once for the whole batch. Duplicates are resolved
+    /// once and up to `concurrency` lookups run at a time. Returns a list in
+    /// input order holding a PyPaymentInfo or the exception for each address.
+    #[pyo3(signature = (addresses, concurrency=DEFAULT_BATCH_CONCURRENCY))]
+    fn resolve_many(&self, py: Python<'_>, addresses: Vec<String>, concurrency: usize) -> PyResult<Vec<PyObject>> {
+        let results = py.allow_threads(|| {
+            get_runtime().block_on(self.resolver.resolve_many(&addresses, concurrency))
+        });
+        
+        results.into_iter()
+            .map(|result| match result {
+                Ok(instruction) => Ok(Py::new(py, PyPaymentInfo::from(instruction))?.into_py(py)),
+                Err(err) => Ok(to_py_err(err).into_value(py).into_py(py)),
+            })
+            .collect()
+    }
+    
+    /// Resolve a human-readable Bitcoin address from asyncio
+    ///
+    /// Returns an awaitable bound to the running event loop; no Python thread
+    /// is blocked while the lookup is in flight. Cancelling the awaitable
+    /// aborts the lookup.
+    fn resolve_address_async<'py>(&self, py: Python<'py>, address: String) -> PyResult<&'py PyAny> {
+        let resolver = self.resolver.clone();
+        self.spawn_for_asyncio(py, async move { resolver.resolve_address(&address).await })
+    }
+    
+    /// Resolve a user@domain combination from asyncio
+    fn resolve_async<'py>(&self, py: Python<'py>, user: String, domain: String) -> PyResult<&'py PyAny> {
+        let resolver = self.resolver.clone();
+        self.spawn_for_asyncio(py, async move { resolver.resolve(&user, &domain).await })
+    }
+    
+    /// Get resolution and failure counts, or None when metrics are disabled
+    ///
+    /// Failures are broken down by kind ("dns", "timeout", ...).
+    fn get_metrics<'py>(&self, py: Python<'py>) -> PyResult<Option<&'py PyDict>> {
+        let metrics = match self.resolver.metrics() {
+            Some(metrics) => metrics,
+            None => return Ok(None),
+        };
+        
+        let stats = metrics.get_resolution_stats();
+        let failures = PyDict::new(py);
+        for (kind, count) in metrics.get_failure_stats().counts {
+            failures.set_item(kind.as_str(), count)?;
+        }
+        
+        let dict = PyDict::new(py);
+        dict.set_item("total", stats.total)?;
+        dict.set_item("success", stats.success)?;
+        dict.set_item("failed", stats.failed)?;
+        dict.set_item("success_rate", stats.success_rate)?;
+        dict.set_item("failures", failures)?;
+        
+        let cache = metrics.get_cache_stats();
+        dict.set_item("cache_hits", cache.hits)?;
+        dict.set_item("cache_misses", cache.misses)?;
+        dict.set_item("cache_hit_rate", cache.hit_rate)?;
+        Ok(Some(dict))
+    }
+    
+    /// Render metrics in OpenMetrics text format, or None when metrics are disabled
+    fn render_metrics(&self, py: Python<'_>) -> Option<String> {
+        py.allow_threads(|| self.resolver.render_metrics())
     }
     
     /// Parse a human-readable Bitcoin address
@@ -81,28 +217,152 @@ impl PyResolver {
     }
 }
 
+impl PyResolver {
+    /// Run a resolution on the runtime and return an asyncio future for its result
+    fn spawn_for_asyncio<'py, F>(&self, py: Python<'py>, resolution: F) -> PyResult<&'py PyAny>
+    where
+        F: std::future::Future<Output = Result<PaymentInfo, Bip353Error>> + Send + 'static,
+    {
+        let event_loop = py.import("asyncio")?.call_method0("get_running_loop")?;
+        let future = event_loop.call_method0("create_future")?;
+        
+        let loop_ref: PyObject = event_loop.into();
+        let future_ref: PyObject = future.into();
+        let (handle, registration) = AbortHandle::new_pair();
+        let resolver = self.resolver.clone();
+        get_runtime().spawn(async move {
+            // A resolution either completes and records its own outcome, or
+            // is aborted before completing and is recorded as cancelled here
+            let result = match Abortable::new(resolution, registration).await {
+                Ok(result) => result,
+                Err(Aborted) => {
+                    resolver.record_failure(&Bip353Error::Cancelled);
+                    return;
+                }
+            };
+            
+            // Convert before taking the GIL, which is then held only to build
+            // the Python objects and schedule the completion
+            let outcome = result.map(PyPaymentInfo::from).map_err(to_py_err);
+            Python::with_gil(|py| {
+                if let Err(err) = complete_asyncio_future(py, &loop_ref, &future_ref, outcome) {
+                    err.print(py);
+                }
+            });
+        });
+        
+        let on_done = Py::new(py, AbortOnCancel { handle })?;
+        future.call_method1("add_done_callback", (on_done,))?;
+        
+        Ok(future)
+    }
+}
+
+/// Convert a resolution report into a dict
+fn report_dict<'py>(py: Python<'py>, report: &ResolutionReport) -> PyResult<&'py PyDict> {
+    let dict = PyDict::new(py);
+    dict.set_item("cache", report.cache.as_str())?;
+    dict.set_item("stale", report.stale)?;
+    dict.set_item("coalesced", report.coalesced)?;
+    dict.set_item("upstream", report.upstream.map(|addr| addr.to_string()))?;
+    dict.set_item("rtt", report.rtt.as_secs_f64())?;
+    dict.set_item("queries", report.queries)?;
+    dict.set_item("bytes_received", report.bytes_received)?;
+    dict.set_item("processing_time", report.processing_time.as_secs_f64())?;
+    dict.set_item("total_time", report.total_time.as_secs_f64())?;
+    dict.set_item("ttl_remaining", report.ttl_remaining.map(|ttl| ttl.as_secs_f64()))?;
+    Ok(dict)
+}
+
+/// `set_future_result` as a Python callable, built on first use
+static SET_FUTURE_RESULT: GILOnceCell<PyObject> = GILOnceCell::new();
+
+/// Hand a result to an asyncio future from a runtime thread
+fn complete_asyncio_future(
+    py: Python<'_>,
+    event_loop: &PyObject,
+    future: &PyObject,
+    outcome: PyResult<PyPaymentInfo>,
+) -> PyResult<()> {
+    let (method, value): (&PyString, PyObject) = match outcome {
+        Ok(info) => (intern!(py, "set_result"), Py::new(py, info)?.into_py(py)),
+        Err(err) => (intern!(py, "set_exception"), err.into_value(py).into_py(py)),
+    };
+    
+    let complete = SET_FUTURE_RESULT.get_or_try_init(py, || {
+        wrap_pyfunction!(set_future_result, py).map(|function| function.into_py(py))
+    })?;
+    event_loop.call_method1(
+        py,
+        intern!(py, "call_soon_threadsafe"),
+        (complete.clone_ref(py), future.clone_ref(py), method, value),
+    )?;
+    Ok(())
+}
+
+/// Complete an asyncio future on its event loop, unless it was cancelled meanwhile
+#[pyfunction]
+fn set_future_result(future: &PyAny, method: &str, value: PyObject) -> PyResult<()> {
+    if !future.call_method0("done")?.is_true()? {
+        future.call_method1(method, (value,))?;
+    }
+    Ok(())
+}
+
+/// asyncio done-callback that aborts the resolution when the future is cancelled
+///
+/// Aborting a resolution that already completed does nothing.
+#[pyclass]
+struct AbortOnCancel {
+    handle: AbortHandle,
+}
+
+#[pymethods]
+impl AbortOnCancel {
+    fn __call__(&self, future: &PyAny) -> PyResult<()> {
+        if future.call_method0("cancelled")?.is_true()? {
+            self.handle.abort();
+        }
+        Ok(())
+    }
+}
+
 /// Python wrapper for payment instructions
+///
+/// Python objects are created on first access and reused afterwards.
 #[pyclass]
 pub struct PyPaymentInfo {
-    instruction: PaymentInfo,
+    instruction: Arc<PaymentInfo>,
+    uri: GILOnceCell<Py<PyString>>,
+    parameters: GILOnceCell<Py<PyParameters>>,
+}
+
+impl From<PaymentInfo> for PyPaymentInfo {
+    fn from(instruction: PaymentInfo) -> Self {
+        Self {
+            instruction: Arc::new(instruction),
+            uri: GILOnceCell::new(),
+            parameters: GILOnceCell::new(),
+        }
+    }
 }
 
 #[pymethods]
 impl PyPaymentInfo {
     /// Get the URI
     #[getter]
-    fn uri(&self) -> String {
-        self.instruction.uri.clone()
+    fn uri(&self, py: Python<'_>) -> Py<PyString> {
+        self.uri.get_or_init(py, || PyString::new(py, &self.instruction.uri).into()).clone_ref(py)
     }
     
     /// Get the payment type
     #[getter]
-    fn payment_type(&self) -> String {
+    fn payment_type<'py>(&self, py: Python<'py>) -> &'py PyString {
         match self.instruction.payment_type {
-            PaymentType::OnChain => "on-chain".to_string(),
-            PaymentType::Lightning => "lightning".to_string(),
-            PaymentType::LightningOffer => "lightning-offer".to_string(),
-            PaymentType::Unknown => "unknown".to_string(),
+            PaymentType::OnChain => intern!(py, "on-chain"),
+            PaymentType::Lightning => intern!(py, "lightning"),
+            PaymentType::LightningOffer => intern!(py, "lightning-offer"),
+            PaymentType::Unknown => intern!(py, "unknown"),
         }
     }
     
@@ -112,24 +372,168 @@ impl PyPaymentInfo {
         self.instruction.is_reusable
     }
     
-    /// Get parameters
+    /// Get parameters as a read-only mapping
     #[getter]
-    fn parameters(&self, py: Python) -> PyObject {
-        let dict = PyDict::new(py);
+    fn parameters(&self, py: Python<'_>) -> PyResult<Py<PyParameters>> {
+        if let Some(parameters) = self.parameters.get(py) {
+            return Ok(parameters.clone_ref(py));
+        }
         
-        for (key, value) in &self.instruction.parameters {
-            dict.set_item(key, value).unwrap();
+        let parameters = Py::new(py, PyParameters {
+            instruction: self.instruction.clone(),
+            dict: GILOnceCell::new(),
+        })?;
+        let _ = self.parameters.set(py, parameters.clone_ref(py));
+        Ok(parameters)
+    }
+}
+
+/// Read-only mapping view of payment URI parameters
+///
+/// Backed by the resolved payment info; values are converted on lookup.
+/// Iteration, `keys()`, `values()` and `items()` share a private dict built
+/// on first use and return live views of it rather than fresh lists.
+#[pyclass(name = "PaymentParameters")]
+pub struct PyParameters {
+    instruction: Arc<PaymentInfo>,
+    dict: GILOnceCell<Py<PyDict>>,
+}
+
+impl PyParameters {
+    fn dict<'py>(&self, py: Python<'py>) -> PyResult<&'py PyDict> {
+        let dict = self.dict.get_or_try_init(py, || -> PyResult<Py<PyDict>> {
+            let dict = PyDict::new(py);
+            for (key, value) in &self.instruction.parameters {
+                dict.set_item(key, value)?;
+            }
+            Ok(dict.into())
+        })?;
+        Ok(dict.as_ref(py))
+    }
+}
+
+#[pymethods]
+impl PyParameters {
+    fn __getitem__(&self, key: &str) -> PyResult<&str> {
+        self.instruction.parameters.get(key)
+            .map(String::as_str)
+            .ok_or_else(|| PyKeyError::new_err(key.to_string()))
+    }
+    
+    fn __len__(&self) -> usize {
+        self.instruction.parameters.len()
+    }
+    
+    fn __contains__(&self, key: &str) -> bool {
+        self.instruction.parameters.contains_key(key)
+    }
+    
+    fn __iter__<'py>(&self, py: Python<'py>) -> PyResult<&'py PyAny> {
+        self.dict(py)?.call_method0(intern!(py, "__iter__"))
+    }
+    
+    fn __repr__(&self) -> String {
+        format!("PaymentParameters({:?})", self.instruction.parameters)
+    }
+    
+    /// Get a parameter, or `default` if it is not present
+    #[pyo3(signature = (key, default=None))]
+    fn get(&self, py: Python<'_>, key: &str, default: Option<PyObject>) -> PyObject {
+        match self.instruction.parameters.get(key) {
+            Some(value) => value.into_py(py),
+            None => default.unwrap_or_else(|| py.None()),
         }
+    }
+    
+    fn keys<'py>(&self, py: Python<'py>) -> PyResult<&'py PyAny> {
+        self.dict(py)?.call_method0(intern!(py, "keys"))
+    }
+    
+    fn values<'py>(&self, py: Python<'py>) -> PyResult<&'py PyAny> {
+        self.dict(py)?.call_method0(intern!(py, "values"))
+    }
+    
+    fn items<'py>(&self, py: Python<'py>) -> PyResult<&'py PyAny> {
+        self.dict(py)?.call_method0(intern!(py, "items"))
+    }
+}
+
+/// Local DNS server with signed zones, for tests and benchmarks (`testing` feature)
+///
+/// Serves `user0@example.com` to `user{users - 1}@example.com` on localhost
+/// until the object is garbage collected.
+#[cfg(feature = "testing")]
+#[pyclass(name = "LocalDnsServer")]
+pub struct PyLocalDnsServer {
+    server: crate::testing::DnsServer,
+}
+
+#[cfg(feature = "testing")]
+#[pymethods]
+impl PyLocalDnsServer {
+    /// Start serving; `latency_ms` delays every response and `udp_loss`
+    /// drops that fraction of UDP queries
+    #[new]
+    #[pyo3(signature = (users=1_000_000, latency_ms=0.0, udp_loss=0.0))]
+    fn new(users: u64, latency_ms: f64, udp_loss: f64) -> PyResult<Self> {
+        use crate::testing::{DnsServer, DnsServerConfig, ZoneConfig};
         
-        dict.into()
+        let config = DnsServerConfig {
+            zones: ZoneConfig { users, ..ZoneConfig::default() },
+            ..DnsServerConfig::default()
+        }
+        .with_latency(std::time::Duration::from_secs_f64(latency_ms.max(0.0) / 1000.0))
+        .with_udp_loss(udp_loss);
+        let server = DnsServer::start(config).map_err(|e| PyRuntimeError::new_err(e.to_string()))?;
+        Ok(Self { server })
+    }
+    
+    /// "ip:port" of the server
+    #[getter]
+    fn address(&self) -> String {
+        self.server.addr().to_string()
+    }
+    
+    /// Query counts, as a dict
+    fn stats<'py>(&self, py: Python<'py>) -> PyResult<&'py PyDict> {
+        let stats = self.server.stats();
+        let dict = PyDict::new(py);
+        dict.set_item("udp_queries", stats.udp_queries)?;
+        dict.set_item("tcp_queries", stats.tcp_queries)?;
+        dict.set_item("dropped", stats.dropped)?;
+        dict.set_item("truncated", stats.truncated)?;
+        Ok(dict)
+    }
+    
+    /// Create a resolver that validates this server's answers
+    ///
+    /// Lookups fail once the server is garbage collected, so keep a reference
+    /// for as long as the resolver is used.
+    #[pyo3(signature = (enable_cache=false, cache_ttl_secs=300, enable_metrics=false))]
+    fn resolver(&self, enable_cache: bool, cache_ttl_secs: u64, enable_metrics: bool) -> PyResolver {
+        let mut config = ResolverConfig::default().with_metrics(enable_metrics);
+        if enable_cache {
+            config = config.with_cache_ttl(std::time::Duration::from_secs(cache_ttl_secs));
+        }
+        let resolver = Bip353Resolver::with_hrn_resolver(crate::DynHrnResolver::new(self.server.resolver()), config);
+        PyResolver { resolver: Arc::new(resolver) }
     }
 }
 
 /// Python module
 #[pymodule]
-pub fn bip353(_py: Python, m: &PyModule) -> PyResult<()> {
+pub fn bip353(py: Python, m: &PyModule) -> PyResult<()> {
+    m.add_function(wrap_pyfunction!(init_runtime, m)?)?;
     m.add_class::<PyResolver>()?;
     m.add_class::<PyPaymentInfo>()?;
+    m.add_class::<PyParameters>()?;
+    #[cfg(feature = "testing")]
+    m.add_class::<PyLocalDnsServer>()?;
+    
+    // Let isinstance(info.parameters, Mapping) hold
+    py.import("collections.abc")?
+        .getattr("Mapping")?
+        .call_method1("register", (m.getattr("PaymentParameters")?,))?;
     
     Ok(())
 }
\ No newline at end of file
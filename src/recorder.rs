@@ -0,0 +1,331 @@
+//! Flight recorder: the most recent resolutions, kept for post-incident analysis
+//!
+//! Resolutions are written into fixed-size rings of atomic slots, each
+//! guarded by a sequence number (a seqlock). Writers never wait: a slot still
+//! being written by another thread is skipped. Readers copy a slot and retry
+//! nothing; a slot that changed under them is left out of the dump.
+
+use std::fmt::Write;
+use std::net::{Ipv6Addr, SocketAddr};
+use std::sync::atomic::{fence, AtomicU64, Ordering};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+use crate::config::FlightRecorderConfig;
+use crate::error::ErrorKind;
+use crate::report::{CacheStatus, ResolutionReport};
+
+/// One recorded resolution
+///
+/// Stages run in order: cache lookup, transport (`rtt`), then `processing`;
+/// `total` also covers middleware such as retries, but not address parsing,
+/// which happens before the resolution starts.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct FlightRecord {
+    /// `FlightRecorder::hrn_hash` of the name, so names are not retained
+    pub hrn_hash: u64,
+    pub started_at: SystemTime,
+    pub total: Duration,
+    pub rtt: Duration,
+    pub processing: Duration,
+    /// Error kind of a failed resolution, None on success
+    pub error: Option<ErrorKind>,
+    pub cache: CacheStatus,
+    pub coalesced: bool,
+    pub stale: bool,
+    pub queries: u16,
+    pub upstream: Option<SocketAddr>,
+    /// Kept in the slow-query ring
+    pub pinned: bool,
+}
+
+impl FlightRecord {
+    /// Format as a single-line JSON object
+    pub fn to_json(&self) -> String {
+        let started_at_us = self.started_at.duration_since(UNIX_EPOCH).unwrap_or_default().as_micros();
+        let mut out = String::with_capacity(256);
+        let _ = write!(
+            out,
+            "{{\"hrn_hash\":\"{:016x}\",\"started_at_us\":{},\"total_us\":{},\"rtt_us\":{},\"processing_us\":{},",
+            self.hrn_hash,
+            started_at_us,
+            self.total.as_micros(),
+            self.rtt.as_micros(),
+            self.processing.as_micros(),
+        );
+        let _ = write!(
+            out,
+            "\"outcome\":\"{}\",\"cache\":\"{}\",\"coalesced\":{},\"stale\":{},\"queries\":{},",
+            self.error.as_ref().map_or("success", ErrorKind::as_str),
+            self.cache.as_str(),
+            self.coalesced,
+            self.stale,
+            self.queries,
+        );
+        match self.upstream {
+            Some(upstream) => { let _ = write!(out, "\"upstream\":\"{}\",", upstream); },
+            None => out.push_str("\"upstream\":null,"),
+        }
+        let _ = write!(out, "\"pinned\":{}}}", self.pinned);
+        out
+    }
+}
+
+/// Fixed-size record of the most recent resolutions
+///
+/// Resolutions slower than the configured threshold go to a separate pinned
+/// ring, so a burst of fast traffic cannot push them out.
+#[derive(Debug)]
+pub struct FlightRecorder {
+    recent: Ring,
+    pinned: Ring,
+    slow_threshold: Duration,
+}
+
+impl FlightRecorder {
+    pub fn new(config: FlightRecorderConfig) -> Self {
+        Self {
+            recent: Ring::new(config.capacity),
+            pinned: Ring::new(config.pinned_capacity),
+            slow_threshold: config.slow_threshold,
+        }
+    }
+    
+    /// Stable 64-bit FNV-1a hash of a "user@domain" name, as stored in records
+    pub fn hrn_hash(hrn: &str) -> u64 {
+        hrn.bytes().fold(0xcbf2_9ce4_8422_2325, |hash, byte| {
+            (hash ^ byte as u64).wrapping_mul(0x0100_0000_01b3)
+        })
+    }
+    
+    /// Record a finished resolution
+    pub(crate) fn record(
+        &self,
+        hrn: &str,
+        started_at: SystemTime,
+        error: Option<ErrorKind>,
+        report: &ResolutionReport,
+    ) {
+        let pinned = report.total_time >= self.slow_threshold;
+        let upstream = report.upstream.map_or(0, |addr| match addr.ip() {
+            std::net::IpAddr::V4(ip) => u128::from(ip.to_ipv6_mapped()),
+            std::net::IpAddr::V6(ip) => u128::from(ip),
+        });
+        let flags = report.coalesced as u64
+            | (report.stale as u64) << 1
+            | (report.upstream.is_some() as u64) << 2;
+        let meta = error.map_or(0, |kind| kind as u64 + 1)
+            | (report.cache as u64) << 8
+            | flags << 16
+            | (report.queries.min(u16::MAX as u32) as u64) << 24
+            | (report.upstream.map_or(0, |addr| addr.port()) as u64) << 40;
+        
+        let words = [
+            Self::hrn_hash(hrn),
+            started_at.duration_since(UNIX_EPOCH).unwrap_or_default().as_micros() as u64,
+            report.total_time.as_micros() as u64,
+            report.rtt.as_micros() as u64,
+            report.processing_time.as_micros() as u64,
+            meta,
+            (upstream >> 64) as u64,
+            upstream as u64,
+        ];
+        
+        if pinned {
+            self.pinned.write(words);
+        } else {
+            self.recent.write(words);
+        }
+    }
+    
+    /// Copy the recorded resolutions, oldest first
+    ///
+    /// Does not block recording; entries overwritten during the copy are skipped.
+    pub fn dump(&self) -> Vec<FlightRecord> {
+        let mut records: Vec<FlightRecord> = self.recent.read()
+            .map(|words| decode(words, false))
+            .chain(self.pinned.read().map(|words| decode(words, true)))
+            .collect();
+        records.sort_by_key(|record| record.started_at);
+        records
+    }
+    
+    /// Dump as JSON lines, oldest first
+    pub fn dump_json(&self) -> String {
+        let mut out = String::new();
+        for record in self.dump() {
+            out.push_str(&record.to_json());
+            out.push('\n');
+        }
+        out
+    }
+}
+
+fn decode(words: [u64; WORDS], pinned: bool) -> FlightRecord {
+    let meta = words[5];
+    let flags = (meta >> 16) & 0xff;
+    let upstream = (flags & 4 != 0).then(|| {
+        let ip = Ipv6Addr::from((words[6] as u128) << 64 | words[7] as u128).to_canonical();
+        SocketAddr::new(ip, (meta >> 40) as u16)
+    });
+    
+    FlightRecord {
+        hrn_hash: words[0],
+        started_at: UNIX_EPOCH + Duration::from_micros(words[1]),
+        total: Duration::from_micros(words[2]),
+        rtt: Duration::from_micros(words[3]),
+        processing: Duration::from_micros(words[4]),
+        error: match (meta & 0xff) as usize {
+            0 => None,
+            kind => ErrorKind::ALL.get(kind - 1).copied(),
+        },
+        cache: CacheStatus::from_u8((meta >> 8) as u8),
+        coalesced: flags & 1 != 0,
+        stale: flags & 2 != 0,
+        queries: (meta >> 24) as u16,
+        upstream,
+        pinned,
+    }
+}
+
+// Words per slot: hash, start, total, rtt, processing, meta, upstream (2)
+const WORDS: usize = 8;
+
+/// One record guarded by a sequence number: odd while being written, zero
+/// while never written
+#[derive(Debug, Default)]
+struct Slot {
+    seq: AtomicU64,
+    words: [AtomicU64; WORDS],
+}
+
+#[derive(Debug)]
+struct Ring {
+    slots: Box<[Slot]>,
+    head: AtomicU64,
+}
+
+impl Ring {
+    fn new(capacity: usize) -> Self {
+        Self {
+            slots: (0..capacity).map(|_| Slot::default()).collect(),
+            head: AtomicU64::new(0),
+        }
+    }
+    
+    fn write(&self, words: [u64; WORDS]) {
+        if self.slots.is_empty() {
+            return;
+        }
+        let ticket = self.head.fetch_add(1, Ordering::Relaxed);
+        let slot = &self.slots[(ticket % self.slots.len() as u64) as usize];
+        
+        // Claim the slot; if a writer that lapped the ring still holds it, drop the record
+        let seq = slot.seq.load(Ordering::Relaxed);
+        if seq & 1 != 0
+            || slot.seq.compare_exchange(seq, seq + 1, Ordering::Relaxed, Ordering::Relaxed).is_err()
+        {
+            return;
+        }
+        fence(Ordering::Release);
+        
+        for (word, value) in slot.words.iter().zip(words) {
+            word.store(value, Ordering::Relaxed);
+        }
+        slot.seq.store(seq + 2, Ordering::Release);
+    }
+    
+    fn read(&self) -> impl Iterator<Item = [u64; WORDS]> + '_ {
+        self.slots.iter().filter_map(|slot| {
+            let before = slot.seq.load(Ordering::Acquire);
+            if before == 0 || before & 1 != 0 {
+                return None;
+            }
+            let words = std::array::from_fn(|i| slot.words[i].load(Ordering::Relaxed));
+            fence(Ordering::Acquire);
+            (slot.seq.load(Ordering::Relaxed) == before).then_some(words)
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::Arc;
+    
+    fn report(total: Duration) -> ResolutionReport {
+        ResolutionReport {
+            cache: CacheStatus::Miss,
+            upstream: Some("[2001:db8::1]:53".parse().unwrap()),
+            queries: 2,
+            rtt: Duration::from_millis(3),
+            total_time: total,
+            ..Default::default()
+        }
+    }
+    
+    #[test]
+    fn test_record_round_trip() {
+        let recorder = FlightRecorder::new(FlightRecorderConfig::default());
+        let started_at = UNIX_EPOCH + Duration::from_secs(1_700_000_000);
+        recorder.record("alice@example.com", started_at, Some(ErrorKind::Dnssec), &report(Duration::from_millis(5)));
+        
+        let records = recorder.dump();
+        assert_eq!(records.len(), 1);
+        let record = &records[0];
+        assert_eq!(record.hrn_hash, FlightRecorder::hrn_hash("alice@example.com"));
+        assert_eq!(record.started_at, started_at);
+        assert_eq!(record.error, Some(ErrorKind::Dnssec));
+        assert_eq!(record.cache, CacheStatus::Miss);
+        assert_eq!(record.queries, 2);
+        assert_eq!(record.upstream, Some("[2001:db8::1]:53".parse().unwrap()));
+        assert!(!record.pinned);
+        assert!(recorder.dump_json().contains("\"outcome\":\"dnssec\""));
+    }
+    
+    #[test]
+    fn test_slow_queries_are_pinned() {
+        let recorder = FlightRecorder::new(FlightRecorderConfig {
+            capacity: 4,
+            pinned_capacity: 2,
+            slow_threshold: Duration::from_secs(1),
+        });
+        
+        recorder.record("slow@example.com", SystemTime::now(), None, &report(Duration::from_secs(2)));
+        for _ in 0..100 {
+            recorder.record("fast@example.com", SystemTime::now(), None, &report(Duration::from_millis(1)));
+        }
+        
+        let records = recorder.dump();
+        assert_eq!(records.len(), 5);
+        assert_eq!(records.iter().filter(|r| r.pinned).count(), 1);
+        assert!(records.iter().any(|r| r.hrn_hash == FlightRecorder::hrn_hash("slow@example.com")));
+    }
+    
+    #[test]
+    fn test_concurrent_recording() {
+        let recorder = Arc::new(FlightRecorder::new(FlightRecorderConfig {
+            capacity: 8,
+            ..Default::default()
+        }));
+        let threads: Vec<_> = (0..4u32).map(|i| {
+            let recorder = recorder.clone();
+            std::thread::spawn(move || {
+                let report = ResolutionReport { queries: i, ..report(Duration::from_millis(1)) };
+                for _ in 0..10_000 {
+                    recorder.record(&format!("{}@b.c", i), SystemTime::now(), None, &report);
+                }
+            })
+        }).collect();
+        
+        // Dumps taken during recording only ever see complete records
+        for _ in 0..100 {
+            for record in recorder.dump() {
+                assert_eq!(record.hrn_hash, FlightRecorder::hrn_hash(&format!("{}@b.c", record.queries)));
+            }
+        }
+        for thread in threads {
+            thread.join().unwrap();
+        }
+        assert_eq!(recorder.dump().len(), 8);
+    }
+}
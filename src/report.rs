@@ -0,0 +1,149 @@
+//! Per-resolution reports: how an answer was obtained
+
+use std::net::SocketAddr;
+use std::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, AtomicU8, Ordering};
+use std::time::Duration;
+
+/// Cache involvement in a resolution
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum CacheStatus {
+    /// Caching is disabled
+    #[default]
+    Off,
+    /// Answered from a fresh cache entry
+    Hit,
+    /// Resolved through the network
+    Miss,
+}
+
+impl CacheStatus {
+    pub(crate) fn from_u8(value: u8) -> Self {
+        match value {
+            x if x == CacheStatus::Hit as u8 => CacheStatus::Hit,
+            x if x == CacheStatus::Miss as u8 => CacheStatus::Miss,
+            _ => CacheStatus::Off,
+        }
+    }
+    
+    pub fn as_str(self) -> &'static str {
+        match self {
+            CacheStatus::Off => "off",
+            CacheStatus::Hit => "hit",
+            CacheStatus::Miss => "miss",
+        }
+    }
+}
+
+/// How one resolution was answered
+///
+/// Transport fields cover the lookups made by this call only; a coalesced
+/// resolution shares another caller's lookup and reports none of its own.
+#[derive(Debug, Clone, Default)]
+pub struct ResolutionReport {
+    pub cache: CacheStatus,
+    /// A cached entry for the name had expired and was refreshed
+    pub stale: bool,
+    /// The answer came from a concurrent lookup of the same name
+    pub coalesced: bool,
+    /// DNS resolver queried, if this call sent queries over the DNS transport
+    ///
+    /// None for cache hits, coalesced answers and other transports (custom
+    /// HRN resolvers, HTTP).
+    pub upstream: Option<SocketAddr>,
+    /// Time spent in lookups, including DNSSEC proof validation
+    pub rtt: Duration,
+    /// Lookups sent to the upstream, including retries and LNURL requests
+    pub queries: u32,
+    /// Bytes of DNSSEC proofs and records received
+    pub bytes_received: u64,
+    /// Time spent parsing payment instructions and building the URI
+    pub processing_time: Duration,
+    /// Wall time of the whole resolution
+    pub total_time: Duration,
+    /// Time until the cached answer expires, if it is cached
+    pub ttl_remaining: Option<Duration>,
+}
+
+const NO_TTL: u64 = u64::MAX;
+
+/// Collects a report while a lookup runs through the pipeline
+#[derive(Debug)]
+pub(crate) struct ReportCollector {
+    cache: AtomicU8,
+    stale: AtomicBool,
+    coalesced: AtomicBool,
+    rtt_us: AtomicU64,
+    queries: AtomicU32,
+    bytes_received: AtomicU64,
+    processing_us: AtomicU64,
+    ttl_remaining_ms: AtomicU64,
+}
+
+impl Default for ReportCollector {
+    fn default() -> Self {
+        Self {
+            cache: AtomicU8::new(CacheStatus::Off as u8),
+            stale: AtomicBool::new(false),
+            coalesced: AtomicBool::new(false),
+            rtt_us: AtomicU64::new(0),
+            queries: AtomicU32::new(0),
+            bytes_received: AtomicU64::new(0),
+            processing_us: AtomicU64::new(0),
+            ttl_remaining_ms: AtomicU64::new(NO_TTL),
+        }
+    }
+}
+
+impl ReportCollector {
+    pub(crate) fn cache_hit(&self, ttl_remaining: Duration) {
+        self.cache.store(CacheStatus::Hit as u8, Ordering::Relaxed);
+        self.set_ttl_remaining(ttl_remaining);
+    }
+    
+    pub(crate) fn cache_miss(&self, stale: bool) {
+        self.cache.store(CacheStatus::Miss as u8, Ordering::Relaxed);
+        self.stale.store(stale, Ordering::Relaxed);
+    }
+    
+    pub(crate) fn set_ttl_remaining(&self, ttl: Duration) {
+        self.ttl_remaining_ms.store(ttl.as_millis().min(NO_TTL as u128 - 1) as u64, Ordering::Relaxed);
+    }
+    
+    pub(crate) fn coalesced(&self) {
+        self.coalesced.store(true, Ordering::Relaxed);
+    }
+    
+    /// Count one upstream lookup
+    pub(crate) fn query(&self, rtt: Duration, bytes_received: u64) {
+        self.queries.fetch_add(1, Ordering::Relaxed);
+        self.rtt_us.fetch_add(rtt.as_micros() as u64, Ordering::Relaxed);
+        self.bytes_received.fetch_add(bytes_received, Ordering::Relaxed);
+    }
+    
+    pub(crate) fn processing(&self, elapsed: Duration) {
+        self.processing_us.fetch_add(elapsed.as_micros() as u64, Ordering::Relaxed);
+    }
+    
+    /// Build the report; `upstream` is the DNS resolver, None for other transports
+    pub(crate) fn finish(&self, upstream: Option<SocketAddr>, total_time: Duration) -> ResolutionReport {
+        let cache = CacheStatus::from_u8(self.cache.load(Ordering::Relaxed));
+        let queries = self.queries.load(Ordering::Relaxed);
+        let ttl_remaining = match self.ttl_remaining_ms.load(Ordering::Relaxed) {
+            NO_TTL => None,
+            ms => Some(Duration::from_millis(ms)),
+        };
+        
+        ResolutionReport {
+            cache,
+            stale: self.stale.load(Ordering::Relaxed),
+            coalesced: self.coalesced.load(Ordering::Relaxed),
+            upstream: upstream.filter(|_| queries > 0),
+            rtt: Duration::from_micros(self.rtt_us.load(Ordering::Relaxed)),
+            queries,
+            bytes_received: self.bytes_received.load(Ordering::Relaxed),
+            processing_time: Duration::from_micros(self.processing_us.load(Ordering::Relaxed)),
+            total_time,
+            ttl_remaining,
+        }
+    }
+}
@@ -2,7 +2,14 @@
 
 use bitcoin_payment_instructions::{
     PaymentInstructions,
+    amount::Amount,
     dns_resolver::DNSHrnResolver,
+    hrn_resolution::{
+        HrnResolutionFuture,
+        HrnResolver,
+        HumanReadableName,
+        LNURLResolutionFuture,
+    },
 };
 
 #[cfg(feature = "http")]
@@ -10,16 +17,37 @@ use bitcoin_payment_instructions::http_resolver::HTTPHrnResolver;
 
 use crate::{
     Bip353Error,
+    alloc_profile::{self, AllocStage},
     config::ResolverConfig,
+    exporter,
     types::PaymentInfo,
     parse_address,
     metrics::Bip353Metrics,
+    recorder::{FlightRecord, FlightRecorder},
+    report::ResolutionReport,
+    trace,
+    usdt,
+    middleware::{
+        AddressCache,
+        CacheLayer,
+        Lookup,
+        MetricsLayer,
+        RateLimitLayer,
+        Resolve,
+        ResolveResult,
+        RetryLayer,
+        SingleFlightLayer,
+        Stack,
+        TimeoutLayer,
+    },
 };
 
+use futures::stream::{self, StreamExt};
 use std::collections::HashMap;
+use std::future::Future;
+use std::net::SocketAddr;
 use std::sync::Arc;
-use tokio::sync::RwLock;
-use std::time::{SystemTime, Duration};
+use std::time::{SystemTime, Duration, Instant};
 
 /// Type of resolver to use
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -38,6 +66,8 @@ pub struct SafePaymentInfo {
     pub payment_info: PaymentInfo,
     pub warnings: Vec<AddressWarning>,
     pub last_checked: SystemTime,
+    /// How the answer was obtained
+    pub report: ResolutionReport,
 }
 
 /// Address usage warning
@@ -51,62 +81,180 @@ pub enum AddressWarning {
     DnssecWarning { message: String },
 }
 
-/// Simple address cache with TTL
-#[derive(Debug)]
-struct AddressCache {
-    entries: Arc<RwLock<HashMap<String, CacheEntry>>>,
-    default_ttl: Duration,
-}
-
-#[derive(Debug, Clone)]
-struct CacheEntry {
-    payment_info: PaymentInfo,
-    cached_at: SystemTime,
-    ttl: Duration,
-}
+/// Type-erased HRN resolver selected at runtime
+///
+/// The default transport of `Bip353Resolver`, used where the resolver type
+/// cannot be named statically (FFI, Python, `ResolverType`). Costs one
+/// virtual call per DNS or HTTP lookup.
+pub struct DynHrnResolver(Box<dyn HrnResolver + Send + Sync>);
 
-impl AddressCache {
-    fn new(default_ttl: Duration) -> Self {
-        Self {
-            entries: Arc::new(RwLock::new(HashMap::new())),
-            default_ttl,
-        }
+impl DynHrnResolver {
+    /// Wrap any HRN resolver
+    pub fn new<R: HrnResolver + Send + Sync + 'static>(resolver: R) -> Self {
+        Self(Box::new(resolver))
     }
     
-    async fn get(&self, hrn: &str) -> Option<PaymentInfo> {
-        let entries = self.entries.read().await;
-        if let Some(entry) = entries.get(hrn) {
-            if entry.cached_at.elapsed().unwrap_or(Duration::MAX) < entry.ttl {
-                return Some(entry.payment_info.clone());
-            }
+    /// Build the resolver for `resolver_type` from a configuration
+    pub fn for_type(resolver_type: ResolverType, config: &ResolverConfig) -> Self {
+        match resolver_type {
+            ResolverType::DNS => Self::new(DNSHrnResolver(config.dns_resolver)),
+            #[cfg(feature = "http")]
+            ResolverType::HTTP => Self::new(HTTPHrnResolver),
         }
-        None
+    }
+}
+
+impl HrnResolver for DynHrnResolver {
+    fn resolve_hrn<'a>(&'a self, hrn: &'a HumanReadableName) -> HrnResolutionFuture<'a> {
+        self.0.resolve_hrn(hrn)
     }
     
-    async fn insert(&self, hrn: String, payment_info: PaymentInfo) {
-        let mut entries = self.entries.write().await;
-        entries.insert(hrn, CacheEntry {
-            payment_info,
-            cached_at: SystemTime::now(),
-            ttl: self.default_ttl,
-        });
+    fn resolve_lnurl<'a>(&'a self, url: &'a str) -> HrnResolutionFuture<'a> {
+        self.0.resolve_lnurl(url)
     }
     
-    async fn invalidate(&self, hrn: &str) {
-        let mut entries = self.entries.write().await;
-        entries.remove(hrn);
+    fn resolve_lnurl_to_invoice<'a>(
+        &'a self,
+        callback_url: String,
+        amount: Amount,
+        expected_description_hash: [u8; 32],
+    ) -> LNURLResolutionFuture<'a> {
+        self.0.resolve_lnurl_to_invoice(callback_url, amount, expected_description_hash)
+    }
+}
+
+/// The core resolution step: a DNSSEC-validated lookup through an HRN
+/// resolver, parsed into payment info. Innermost service of every stack.
+pub struct CoreResolver<R> {
+    hrn_resolver: Arc<R>,
+    network: bitcoin::Network,
+}
+
+impl<R> CoreResolver<R> {
+    pub fn new(hrn_resolver: Arc<R>, network: bitcoin::Network) -> Self {
+        Self { hrn_resolver, network }
     }
 }
 
+impl<R: HrnResolver + Send + Sync> Resolve for CoreResolver<R> {
+    fn resolve<'a>(&'a self, lookup: &'a Lookup) -> impl Future<Output = ResolveResult> + Send + 'a {
+        async move {
+            // Parse the payment instructions using the configured resolver
+            let hrn_len = lookup.hrn().len();
+            let transport = trace::Transport::new(&*self.hrn_resolver, lookup.report(), hrn_len);
+            let parse_start = usdt::sdt_start!(instructions__start, hrn_len);
+            let instructions = alloc_profile::staged(AllocStage::Instructions, PaymentInstructions::parse(
+                lookup.hrn(),
+                self.network,
+                &transport,
+                true, // Support proof-of-payment callbacks
+            )).await;
+            transport.finish();
+            let instructions = instructions.map_err(Bip353Error::from);
+            usdt::sdt!(instructions__done, hrn_len, usdt::latency_us(parse_start), usdt::status(&instructions));
+            let instructions = instructions?;
+            
+            let timer = trace::Timer::start(lookup.report());
+            let uri = {
+                let _stage = alloc_profile::enter(AllocStage::Uri);
+                payment_uri(&instructions)
+            };
+            timer.record(trace::URI, lookup.report());
+            
+            // Create payment info
+            let _stage = alloc_profile::enter(AllocStage::PaymentInfo);
+            Ok(PaymentInfo::from_instructions(instructions, uri?))
+        }
+    }
+}
+
+/// Extract the URI based on the payment instructions
+pub fn payment_uri(instructions: &PaymentInstructions) -> Result<String, Bip353Error> {
+    let uri = match instructions {
+        PaymentInstructions::FixedAmount(fixed) => {
+            // For fixed amount instructions, we should have a concrete URI
+            if let Some(method) = fixed.methods().first() {
+                match method {
+                    bitcoin_payment_instructions::PaymentMethod::OnChain(addr) => {
+                        let mut uri = format!("bitcoin:{}", addr);
+                        if let Some(amount) = fixed.max_amount() {
+                            uri.push_str(&format!("?amount={}", amount.btc_decimal_rounding_up_to_sats()));
+                        }
+                        uri
+                    },
+                    bitcoin_payment_instructions::PaymentMethod::LightningBolt11(invoice) => {
+                        format!("bitcoin:?lightning={}", invoice)
+                    },
+                    bitcoin_payment_instructions::PaymentMethod::LightningBolt12(offer) => {
+                        format!("bitcoin:?lno={}", offer)
+                    },
+                }
+            } else {
+                return Err(Bip353Error::InvalidRecord("No payment methods found".into()));
+            }
+        },
+        PaymentInstructions::ConfigurableAmount(configurable) => {
+            // For configurable amount instructions, we'll use a BIP-21 URI with the first method
+            let mut has_method = false;
+            let base_uri = if let Some(method) = configurable.methods().next() {
+                has_method = true;
+                match method {
+                    bitcoin_payment_instructions::PossiblyResolvedPaymentMethod::LNURLPay { .. } => {
+                        "bitcoin:".to_string()
+                    },
+                    bitcoin_payment_instructions::PossiblyResolvedPaymentMethod::Resolved(method) => {
+                        match method {
+                            bitcoin_payment_instructions::PaymentMethod::OnChain(addr) => {
+                                format!("bitcoin:{}", addr)
+                            },
+                            bitcoin_payment_instructions::PaymentMethod::LightningBolt11(invoice) => {
+                                format!("bitcoin:?lightning={}", invoice)
+                            },
+                            bitcoin_payment_instructions::PaymentMethod::LightningBolt12(offer) => {
+                                format!("bitcoin:?lno={}", offer)
+                            },
+                        }
+                    },
+                }
+            } else {
+                "bitcoin:".to_string()
+            };
+            
+            if !has_method {
+                return Err(Bip353Error::InvalidRecord("No payment methods found".into()));
+            }
+            
+            base_uri
+        },
+    };
+    
+    Ok(uri)
+}
+
+/// Layers applied by `Bip353Resolver`, outermost first
+type Pipeline<R> = Stack<CacheLayer,
+    Stack<MetricsLayer,
+    Stack<SingleFlightLayer,
+    Stack<RetryLayer,
+    Stack<RateLimitLayer,
+    Stack<TimeoutLayer,
+    CoreResolver<R>>>>>>>;
+
 /// BIP-353 resolver - (what's actually needed)
-pub struct Bip353Resolver {
-    dns_resolver: DNSHrnResolver,
-    #[cfg(feature = "http")]
-    http_resolver: HTTPHrnResolver,
-    resolver_type: ResolverType,
+///
+/// Generic over the HRN resolver doing the lookups. A concrete `R` (a custom
+/// transport, an in-memory mock) is dispatched statically; the default
+/// `DynHrnResolver` picks DNS or HTTP at runtime. Every resolution runs
+/// through the middleware layers enabled in `ResolverConfig::layers`.
+pub struct Bip353Resolver<R = DynHrnResolver> {
+    hrn_resolver: Arc<R>,
+    pipeline: Pipeline<R>,
     config: ResolverConfig,
     cache: Option<Arc<AddressCache>>,
     metrics: Option<Arc<Bip353Metrics>>,
+    recorder: Option<FlightRecorder>,
+    /// DNS resolver queried by the DNS transport, None for other transports
+    upstream: Option<SocketAddr>,
     // Removed: chain_monitor here (not used yet but will be considered in later versions)
 }
 
@@ -118,191 +266,188 @@ impl Bip353Resolver {
     
     /// Create a new resolver with custom configuration
     pub fn with_config(config: ResolverConfig) -> Result<Self, Bip353Error> {
-        Ok(Self { 
-            dns_resolver: DNSHrnResolver(config.dns_resolver),
-            #[cfg(feature = "http")]
-            http_resolver: HTTPHrnResolver,
-            resolver_type: ResolverType::DNS,
-            config,
-            cache: None,        
-            metrics: None,      
-        })
+        Ok(Self::for_type(ResolverType::DNS, config))
     }
     
     /// Create a new resolver with a specific type
     pub fn with_type(resolver_type: ResolverType) -> Result<Self, Bip353Error> {
-        let config = ResolverConfig::default();
-        
-        Ok(Self { 
-            dns_resolver: DNSHrnResolver(config.dns_resolver),
-            #[cfg(feature = "http")]
-            http_resolver: HTTPHrnResolver,
-            resolver_type,
-            config,
-            cache: None,        
-            metrics: None,      
-        })
+        Ok(Self::for_type(resolver_type, ResolverConfig::default()))
+    }
+    
+    fn for_type(resolver_type: ResolverType, config: ResolverConfig) -> Self {
+        let upstream = matches!(resolver_type, ResolverType::DNS).then_some(config.dns_resolver);
+        Self {
+            upstream,
+            ..Self::with_hrn_resolver(DynHrnResolver::for_type(resolver_type, &config), config)
+        }
     }
     
     /// Create a new resolver with enhanced features (only cache and metrics)
     pub fn with_enhanced_config(
-        config: ResolverConfig,
+        mut config: ResolverConfig,
         enable_cache: bool,
         cache_ttl: Duration,
         enable_metrics: bool,
     ) -> Result<Self, Bip353Error> {
-        let cache = if enable_cache {
-            Some(Arc::new(AddressCache::new(cache_ttl)))
-        } else {
-            None
-        };
+        if enable_cache {
+            config.layers.cache_ttl = Some(cache_ttl);
+        }
+        if enable_metrics {
+            config.layers.metrics = true;
+        }
         
-        let metrics = if enable_metrics {
-            Some(Arc::new(Bip353Metrics::new()))
-        } else {
-            None
-        };
+        Self::with_config(config)
+    }
+}
+
+impl<R: HrnResolver + Send + Sync> Bip353Resolver<R> {
+    /// Create a resolver that looks names up through `hrn_resolver`
+    pub fn with_hrn_resolver(hrn_resolver: R, config: ResolverConfig) -> Self {
+        let hrn_resolver = Arc::new(hrn_resolver);
+        let layers = &config.layers;
         
-        Ok(Self { 
-            dns_resolver: DNSHrnResolver(config.dns_resolver),
-            #[cfg(feature = "http")]
-            http_resolver: HTTPHrnResolver,
-            resolver_type: ResolverType::DNS,
+        let cache = layers.cache_ttl
+            .map(|ttl| Arc::new(AddressCache::new(ttl, config.cache_max_entries)));
+        let metrics = layers.metrics.then(|| Arc::new(Bip353Metrics::new()));
+        let recorder = config.flight_recorder.map(FlightRecorder::new);
+        
+        let core = CoreResolver::new(hrn_resolver.clone(), config.network);
+        let pipeline = Stack::new(layers.timeout.then(|| TimeoutLayer::new(config.timeout())), core);
+        let pipeline = Stack::new(layers.rate_limit.map(RateLimitLayer::new), pipeline);
+        let pipeline = Stack::new(layers.retry.map(RetryLayer::new), pipeline);
+        let pipeline = Stack::new(layers.single_flight.then(SingleFlightLayer::new), pipeline);
+        let pipeline = Stack::new(metrics.clone().map(MetricsLayer::new), pipeline);
+        let pipeline = Stack::new(cache.clone().map(|cache| CacheLayer::new(cache, metrics.clone())), pipeline);
+        
+        Self {
+            hrn_resolver,
+            pipeline,
             config,
             cache,
             metrics,
-        })
+            recorder,
+            upstream: None,
+        }
+    }
+    
+    /// Get the underlying HRN resolver
+    pub fn hrn_resolver(&self) -> &R {
+        &self.hrn_resolver
     }
     
     /// Resolve a human-readable Bitcoin address
     pub async fn resolve(&self, user: &str, domain: &str) -> Result<PaymentInfo, Bip353Error> {
-        // Parse the payment instructions using the appropriate resolver
-        let instructions = match self.resolver_type {
-            ResolverType::DNS => {
-                PaymentInstructions::parse(
-                    &format!("{}@{}", user, domain),
-                    self.config.network,
-                    &self.dns_resolver,
-                    true, // Support proof-of-payment callbacks
-                ).await.map_err(Bip353Error::from)?
-            },
-            #[cfg(feature = "http")]
-            ResolverType::HTTP => {
-                PaymentInstructions::parse(
-                    &format!("{}@{}", user, domain),
-                    self.config.network,
-                    &self.http_resolver,
-                    true, // Support proof-of-payment callbacks
-                ).await.map_err(Bip353Error::from)?
-            },
-        };
-        
-        // Extract the URI based on the payment instructions
-        let uri = match &instructions {
-            PaymentInstructions::FixedAmount(fixed) => {
-                // For fixed amount instructions, we should have a concrete URI
-                if let Some(method) = fixed.methods().first() {
-                    match method {
-                        bitcoin_payment_instructions::PaymentMethod::OnChain(addr) => {
-                            let mut uri = format!("bitcoin:{}", addr);
-                            if let Some(amount) = fixed.max_amount() {
-                                uri.push_str(&format!("?amount={}", amount.btc_decimal_rounding_up_to_sats()));
-                            }
-                            uri
-                        },
-                        bitcoin_payment_instructions::PaymentMethod::LightningBolt11(invoice) => {
-                            format!("bitcoin:?lightning={}", invoice)
-                        },
-                        bitcoin_payment_instructions::PaymentMethod::LightningBolt12(offer) => {
-                            format!("bitcoin:?lno={}", offer)
-                        },
-                    }
-                } else {
-                    return Err(Bip353Error::InvalidRecord("No payment methods found".into()));
-                }
-            },
-            PaymentInstructions::ConfigurableAmount(configurable) => {
-                // For configurable amount instructions, we'll use a BIP-21 URI with the first method
-                let mut has_method = false;
-                let base_uri = if let Some(method) = configurable.methods().next() {
-                    has_method = true;
-                    match method {
-                        bitcoin_payment_instructions::PossiblyResolvedPaymentMethod::LNURLPay { .. } => {
-                            "bitcoin:".to_string()
-                        },
-                        bitcoin_payment_instructions::PossiblyResolvedPaymentMethod::Resolved(method) => {
-                            match method {
-                                bitcoin_payment_instructions::PaymentMethod::OnChain(addr) => {
-                                    format!("bitcoin:{}", addr)
-                                },
-                                bitcoin_payment_instructions::PaymentMethod::LightningBolt11(invoice) => {
-                                    format!("bitcoin:?lightning={}", invoice)
-                                },
-                                bitcoin_payment_instructions::PaymentMethod::LightningBolt12(offer) => {
-                                    format!("bitcoin:?lno={}", offer)
-                                },
-                            }
-                        },
-                    }
-                } else {
-                    "bitcoin:".to_string()
-                };
-                
-                if !has_method {
-                    return Err(Bip353Error::InvalidRecord("No payment methods found".into()));
-                }
-                
-                base_uri
-            },
-        };
-        
-        // Create payment info
-        Ok(PaymentInfo::from_instructions(instructions, uri))
+        self.resolve_lookup(&self.lookup(user, domain), trace::Timer::start(None)).await
     }
     
     /// Resolve a human-readable Bitcoin address string
     pub async fn resolve_address(&self, address: &str) -> Result<PaymentInfo, Bip353Error> {
-        let (user, domain) = parse_address(address)?;
-        self.resolve(&user, &domain).await
+        let timer = trace::Timer::start(None);
+        let (user, domain) = {
+            let _stage = alloc_profile::enter(AllocStage::Parse);
+            parse_address(address).inspect_err(|err| self.record_failure(err))?
+        };
+        self.resolve_lookup(&self.lookup(&user, &domain), timer).await
     }
     
-    /// Resolve with basic safety checks (cache + warnings)
-    pub async fn resolve_with_safety_checks(&self, user: &str, domain: &str) -> Result<SafePaymentInfo, Bip353Error> {
-        let hrn = format!("{}@{}", user, domain);
-        
-        // Check cache first
-        if let Some(cache) = &self.cache {
-            if let Some(cached) = cache.get(&hrn).await {
-                // Record cache hit
-                if let Some(metrics) = &self.metrics {
-                    metrics.record_cache_hit();
-                }
-                
-                return Ok(SafePaymentInfo {
-                    payment_info: cached,
-                    warnings: vec![], // No warnings for cached results for now
-                    last_checked: SystemTime::now(),
-                });
-            } else if let Some(metrics) = &self.metrics {
-                metrics.record_cache_miss();
-            }
+    /// Resolve a human-readable Bitcoin address and report how the answer was obtained
+    pub async fn resolve_with_report(
+        &self,
+        user: &str,
+        domain: &str,
+    ) -> (Result<PaymentInfo, Bip353Error>, ResolutionReport) {
+        let start = Instant::now();
+        let lookup = Lookup::new(user, domain).with_report();
+        let result = self.resolve_lookup(&lookup, trace::Timer::start(None)).await;
+        let report = lookup.report()
+            .expect("lookup collects a report")
+            .finish(self.upstream, start.elapsed());
+        (result, report)
+    }
+    
+    /// Resolve a human-readable Bitcoin address string with a resolution report
+    ///
+    /// A malformed address fails before any lookup and gets an empty report.
+    pub async fn resolve_address_with_report(
+        &self,
+        address: &str,
+    ) -> (Result<PaymentInfo, Bip353Error>, ResolutionReport) {
+        match parse_address(address) {
+            Ok((user, domain)) => self.resolve_with_report(&user, &domain).await,
+            Err(err) => {
+                self.record_failure(&err);
+                (Err(err), ResolutionReport::default())
+            },
         }
+    }
+    
+    /// A lookup for `user@domain`, collecting a report when the flight recorder needs one
+    fn lookup(&self, user: &str, domain: &str) -> Lookup {
+        let _stage = alloc_profile::enter(AllocStage::Parse);
+        let lookup = Lookup::new(user, domain);
+        if self.recorder.is_some() { lookup.with_report() } else { lookup }
+    }
+    
+    /// Run a lookup through the pipeline, traced when the `tracing` feature is on
+    async fn resolve_lookup(&self, lookup: &Lookup, parse: trace::Timer) -> ResolveResult {
+        let started = self.recorder.as_ref().map(|_| (SystemTime::now(), Instant::now()));
+        let probe_start = usdt::sdt_start!(resolve__start, lookup.hrn().len());
+        let result = trace::resolution(
+            lookup.hrn(),
+            self.upstream,
+            self.cache.is_some(),
+            parse,
+            self.pipeline.resolve(lookup),
+        ).await;
+        usdt::sdt!(resolve__done, lookup.hrn().len(), usdt::latency_us(probe_start), usdt::status(&result));
         
-        // Resolve using main impl
-        let start_time = std::time::Instant::now();
-        let payment_info = self.resolve(user, domain).await?;
-        let resolution_time = start_time.elapsed();
-        
-        // Cache the result
-        if let Some(cache) = &self.cache {
-            cache.insert(hrn.clone(), payment_info.clone()).await;
+        if let (Some(recorder), Some((started_at, start)), Some(report)) = (&self.recorder, started, lookup.report()) {
+            let report = report.finish(self.upstream, start.elapsed());
+            recorder.record(lookup.hrn(), started_at, result.as_ref().err().map(Bip353Error::kind), &report);
         }
+        result
+    }
+    
+    /// Resolve a batch of human-readable Bitcoin addresses
+    ///
+    /// Duplicate addresses are looked up once and at most `concurrency`
+    /// lookups are in flight at a time. Results are returned in input order.
+    pub async fn resolve_many<S: AsRef<str>>(
+        &self,
+        addresses: &[S],
+        concurrency: usize,
+    ) -> Vec<Result<PaymentInfo, Bip353Error>> {
+        // Map each input to the index of its first occurrence
+        let mut first_seen: HashMap<&str, usize> = HashMap::new();
+        let mut unique: Vec<&str> = Vec::new();
+        let slots: Vec<usize> = addresses.iter()
+            .map(|address| {
+                let address = address.as_ref();
+                *first_seen.entry(address).or_insert_with(|| {
+                    unique.push(address);
+                    unique.len() - 1
+                })
+            })
+            .collect();
         
-        // Record metrics
-        if let Some(metrics) = &self.metrics {
-            metrics.record_resolution_success(domain, resolution_time).await;
+        let mut resolved: Vec<Option<Result<PaymentInfo, Bip353Error>>> = vec![None; unique.len()];
+        let mut lookups = stream::iter(unique.iter().enumerate())
+            .map(|(i, address)| async move { (i, self.resolve_address(address).await) })
+            .buffer_unordered(concurrency.max(1));
+        while let Some((i, result)) = lookups.next().await {
+            resolved[i] = Some(result);
         }
         
+        slots.into_iter()
+            .map(|slot| resolved[slot].clone().expect("every unique address is resolved"))
+            .collect()
+    }
+    
+    /// Resolve with basic safety checks (warnings on top of the configured layers)
+    pub async fn resolve_with_safety_checks(&self, user: &str, domain: &str) -> Result<SafePaymentInfo, Bip353Error> {
+        let (result, report) = self.resolve_with_report(user, domain).await;
+        let payment_info = result?;
+        
         // Basic warnings (can be extended later)
         let warnings = self.check_basic_warnings(&payment_info).await;
         
@@ -310,6 +455,54 @@ impl Bip353Resolver {
             payment_info,
             warnings,
             last_checked: SystemTime::now(),
+            report,
+        })
+    }
+    
+    /// Look up a fresh cached resolution without touching the network
+    ///
+    /// Never blocks on I/O and needs no runtime; returns None on a miss, an
+    /// expired entry, or when caching is disabled.
+    pub fn try_resolve_cached(&self, user: &str, domain: &str) -> Option<PaymentInfo> {
+        let result = self.with_cached(&format!("{}@{}", user, domain), PaymentInfo::clone);
+        if result.is_none() {
+            self.record_cache_miss();
+        }
+        result
+    }
+    
+    /// Run `f` on a fresh cached resolution for `hrn` ("user@domain") without cloning it
+    ///
+    /// Counts a hit; on a miss the caller counts it with `record_cache_miss`,
+    /// unless it starts a `cache_fill`, whose cache layer counts it instead.
+    pub(crate) fn with_cached<T>(&self, hrn: &str, f: impl FnOnce(&PaymentInfo) -> T) -> Option<T> {
+        let result = self.cache.as_ref()?.with_entry(hrn, f);
+        if let (Some(metrics), Some(_)) = (&self.metrics, &result) {
+            metrics.record_cache_hit();
+        }
+        result
+    }
+    
+    pub(crate) fn record_cache_miss(&self) {
+        if let (Some(_), Some(metrics)) = (&self.cache, &self.metrics) {
+            metrics.record_cache_miss();
+        }
+    }
+    
+    /// Resolution that fills the cache for `user@domain`, to spawn in the background
+    ///
+    /// Pairs with `try_resolve_cached`. At most one fill per name runs at a
+    /// time: returns None when one already is, or when caching is disabled.
+    pub fn cache_fill(self: &Arc<Self>, user: &str, domain: &str) -> Option<impl Future<Output = ()> + Send + 'static>
+    where
+        R: 'static,
+    {
+        let lookup = self.lookup(user, domain);
+        let claim = self.cache.as_ref()?.claim_fill(lookup.hrn())?;
+        let resolver = self.clone();
+        Some(async move {
+            let _claim = claim;
+            let _ = resolver.resolve_lookup(&lookup, trace::Timer::start(None)).await;
         })
     }
     
@@ -328,27 +521,91 @@ impl Bip353Resolver {
     /// Clear cache
     pub async fn clear_cache(&self) {
         if let Some(cache) = &self.cache {
-            let mut entries = cache.entries.write().await;
-            entries.clear();
+            cache.clear();
         }
     }
     
     /// Invalidate specific cache entry
     pub async fn invalidate_cache(&self, hrn: &str) {
         if let Some(cache) = &self.cache {
-            cache.invalidate(hrn).await;
+            cache.invalidate(hrn);
         }
     }
     
+    /// Get the resolver configuration
+    pub fn config(&self) -> &ResolverConfig {
+        &self.config
+    }
+    
     /// Get metrics if enabled
     pub fn get_metrics(&self) -> Option<crate::metrics::ResolutionStats> {
         self.metrics.as_ref().map(|m| m.get_resolution_stats())
     }
+    
+    /// Count a failure that never reached the pipeline's metrics layer
+    /// (a malformed address, a caller deadline or a cancellation)
+    pub(crate) fn record_failure(&self, err: &Bip353Error) {
+        if let Some(metrics) = &self.metrics {
+            metrics.record_failure(err.kind());
+        }
+    }
+    
+    /// Get the metrics collector, including per-domain statistics, if enabled
+    pub fn metrics(&self) -> Option<&Bip353Metrics> {
+        self.metrics.as_deref()
+    }
+    
+    /// Get the flight recorder if enabled
+    pub fn flight_recorder(&self) -> Option<&FlightRecorder> {
+        self.recorder.as_ref()
+    }
+    
+    /// Copy the flight recorder's records, oldest first (empty when disabled)
+    pub fn dump_flight_recorder(&self) -> Vec<FlightRecord> {
+        self.recorder.as_ref().map(FlightRecorder::dump).unwrap_or_default()
+    }
+    
+    /// Get latency percentiles if metrics are enabled
+    pub fn get_latency_stats(&self) -> Option<crate::metrics::LatencyStats> {
+        self.metrics.as_ref().map(|m| m.get_latency_stats())
+    }
+    
+    /// Get cache hit/miss statistics if metrics are enabled
+    pub fn get_cache_stats(&self) -> Option<crate::metrics::CacheStats> {
+        self.metrics.as_ref().map(|m| m.get_cache_stats())
+    }
+    
+    /// Render metrics in OpenMetrics text format if metrics are enabled
+    ///
+    /// Adds the cache size and the upstream DNS server to the families of
+    /// [`crate::render_openmetrics`].
+    pub fn render_metrics(&self) -> Option<String> {
+        let metrics = self.metrics.as_ref()?;
+        let mut out = String::with_capacity(4096);
+        exporter::write_metrics(&mut out, metrics);
+        
+        if let Some(cache) = &self.cache {
+            exporter::family(&mut out, "bip353_cache_entries", "gauge", "Entries in the address cache");
+            exporter::sample(&mut out, "bip353_cache_entries", &[], cache.len());
+            exporter::family(&mut out, "bip353_cache_capacity", "gauge", "Maximum cache entries (0 = unbounded)");
+            exporter::sample(&mut out, "bip353_cache_capacity", &[], self.config.cache_max_entries);
+        }
+        
+        if let Some(upstream) = self.upstream {
+            let server = upstream.to_string();
+            exporter::family(&mut out, "bip353_upstream", "info", "Upstream DNS resolver");
+            exporter::sample(&mut out, "bip353_upstream_info", &[("server", &server)], 1);
+        }
+        
+        out.push_str("# EOF\n");
+        Some(out)
+    }
 }
 
 #[cfg(test)]
 mod tests {
     use super::*;
+    use crate::report::CacheStatus;
     
     #[tokio::test]
     #[ignore]
@@ -381,4 +638,280 @@ mod tests {
         assert!(resolver.metrics.is_some());
         assert!(resolver.get_metrics().is_some());
     }
+    
+    /// HRN resolver that fails every lookup and counts them
+    struct CountingResolver(std::sync::atomic::AtomicUsize);
+    
+    impl HrnResolver for CountingResolver {
+        fn resolve_hrn<'a>(&'a self, _hrn: &'a HumanReadableName) -> HrnResolutionFuture<'a> {
+            self.0.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+            Box::pin(async { Err("no records") })
+        }
+        
+        fn resolve_lnurl<'a>(&'a self, _url: &'a str) -> HrnResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+        
+        fn resolve_lnurl_to_invoice<'a>(&'a self, _: String, _: Amount, _: [u8; 32]) -> LNURLResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+    }
+    
+    #[tokio::test]
+    async fn test_custom_hrn_resolver() {
+        let resolver = Bip353Resolver::with_hrn_resolver(
+            CountingResolver(Default::default()),
+            ResolverConfig::default(),
+        );
+        
+        let result = resolver.resolve("alice", "example.com").await;
+        assert!(matches!(result, Err(Bip353Error::DnsError(_))));
+        assert_eq!(resolver.hrn_resolver().0.load(std::sync::atomic::Ordering::Relaxed), 1);
+    }
+    
+    /// HRN resolver that answers every name with the same on-chain address
+    /// after `delay`
+    struct SlowResolver {
+        delay: Duration,
+    }
+    
+    impl HrnResolver for SlowResolver {
+        fn resolve_hrn<'a>(&'a self, _hrn: &'a HumanReadableName) -> HrnResolutionFuture<'a> {
+            Box::pin(async move {
+                tokio::time::sleep(self.delay).await;
+                Ok(bitcoin_payment_instructions::hrn_resolution::HrnResolution::DNSSEC {
+                    proof: None,
+                    result: "bitcoin:bc1qar0srrr7xfkvy5l643lydnw9re59gtzzwf5mdq".to_string(),
+                })
+            })
+        }
+        
+        fn resolve_lnurl<'a>(&'a self, _url: &'a str) -> HrnResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+        
+        fn resolve_lnurl_to_invoice<'a>(&'a self, _: String, _: Amount, _: [u8; 32]) -> LNURLResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+    }
+    
+    #[tokio::test]
+    async fn test_resolution_report() {
+        let config = ResolverConfig::default().with_cache_ttl(Duration::from_secs(60));
+        let resolver = Bip353Resolver::with_hrn_resolver(CountingResolver(Default::default()), config);
+        
+        // Custom transports have no DNS upstream
+        let (result, report) = resolver.resolve_with_report("alice", "example.com").await;
+        assert!(result.is_err());
+        assert_eq!(report.cache, CacheStatus::Miss);
+        assert_eq!(report.queries, 1);
+        assert_eq!(report.upstream, None);
+        assert!(!report.coalesced && !report.stale);
+        assert_eq!(report.ttl_remaining, None);
+        
+        let (result, report) = resolver.resolve_address_with_report("not-an-address").await;
+        assert!(matches!(result, Err(Bip353Error::InvalidAddress(_))));
+        assert_eq!(report.queries, 0);
+        assert_eq!(report.upstream, None);
+    }
+    
+    #[tokio::test]
+    async fn test_resolution_report_upstream() {
+        let ttl = Duration::from_millis(50);
+        let config = ResolverConfig::default().with_cache_ttl(ttl).with_single_flight(true);
+        let mut resolver = Bip353Resolver::with_hrn_resolver(SlowResolver { delay: Duration::from_millis(20) }, config);
+        // As `with_config` sets it for the DNS transport
+        let upstream: SocketAddr = "127.0.0.1:53".parse().unwrap();
+        resolver.upstream = Some(upstream);
+        
+        // Concurrent lookups of one name: one queries, the other shares its answer
+        let (first, second) = tokio::join!(
+            resolver.resolve_with_report("alice", "example.com"),
+            resolver.resolve_with_report("alice", "example.com"),
+        );
+        let (leader, follower) = if first.1.coalesced { (second.1, first.1) } else { (first.1, second.1) };
+        assert!(first.0.is_ok() && second.0.is_ok());
+        assert_eq!((leader.cache, leader.queries, leader.upstream), (CacheStatus::Miss, 1, Some(upstream)));
+        assert!(follower.coalesced);
+        assert_eq!((follower.queries, follower.upstream), (0, None));
+        
+        // A fresh entry answers without a query
+        let (result, report) = resolver.resolve_with_report("alice", "example.com").await;
+        assert!(result.is_ok());
+        assert_eq!((report.cache, report.queries, report.upstream), (CacheStatus::Hit, 0, None));
+        assert!(report.ttl_remaining.is_some());
+        
+        // An expired entry is refreshed through the upstream
+        tokio::time::sleep(ttl * 2).await;
+        let (result, report) = resolver.resolve_with_report("alice", "example.com").await;
+        assert!(result.is_ok());
+        assert!(report.stale);
+        assert_eq!((report.cache, report.queries, report.upstream), (CacheStatus::Miss, 1, Some(upstream)));
+    }
+    
+    #[tokio::test]
+    async fn test_flight_recorder() {
+        let config = ResolverConfig::default().with_flight_recorder(Default::default());
+        let resolver = Bip353Resolver::with_hrn_resolver(CountingResolver(Default::default()), config);
+        
+        let _ = resolver.resolve("alice", "example.com").await;
+        let records = resolver.dump_flight_recorder();
+        assert_eq!(records.len(), 1);
+        assert_eq!(records[0].hrn_hash, FlightRecorder::hrn_hash("alice@example.com"));
+        assert_eq!(records[0].error, Some(crate::ErrorKind::Dns));
+        assert_eq!(records[0].queries, 1);
+    }
+    
+    /// On-chain address answered for each user by `PerNameResolver`
+    const USER_ADDRESSES: [(&str, &str); 3] = [
+        ("alice", "bc1qar0srrr7xfkvy5l643lydnw9re59gtzzwf5mdq"),
+        ("bob", "1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVN2"),
+        ("carol", "3J98t1WpEZ73CNmQviecrnyiWrnqRhWNLy"),
+    ];
+    
+    /// HRN resolver that answers each user with its own address and counts
+    /// the lookups of every user
+    #[derive(Default)]
+    struct PerNameResolver(std::sync::Mutex<HashMap<String, usize>>);
+    
+    impl HrnResolver for PerNameResolver {
+        fn resolve_hrn<'a>(&'a self, hrn: &'a HumanReadableName) -> HrnResolutionFuture<'a> {
+            *self.0.lock().unwrap().entry(hrn.user().to_string()).or_default() += 1;
+            let address = USER_ADDRESSES.iter().find(|(user, _)| *user == hrn.user()).map(|(_, address)| *address);
+            Box::pin(async move {
+                // Let lookups overlap so that completion order differs from input order
+                tokio::time::sleep(Duration::from_millis(if hrn.user() == "alice" { 20 } else { 1 })).await;
+                match address {
+                    Some(address) => Ok(bitcoin_payment_instructions::hrn_resolution::HrnResolution::DNSSEC {
+                        proof: None,
+                        result: format!("bitcoin:{}", address),
+                    }),
+                    None => Err("no records"),
+                }
+            })
+        }
+        
+        fn resolve_lnurl<'a>(&'a self, _url: &'a str) -> HrnResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+        
+        fn resolve_lnurl_to_invoice<'a>(&'a self, _: String, _: Amount, _: [u8; 32]) -> LNURLResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+    }
+    
+    #[tokio::test]
+    async fn test_resolve_many_order_and_duplicates() {
+        let resolver = Bip353Resolver::with_hrn_resolver(PerNameResolver::default(), ResolverConfig::default());
+        let inputs = [
+            "alice@example.com",
+            "bob@example.com",
+            "alice@example.com",
+            "carol@example.com",
+            "bad",
+            "bob@example.com",
+            "alice@example.com",
+        ];
+        let results = resolver.resolve_many(&inputs, 2).await;
+        
+        // Slot i answers input i
+        assert_eq!(results.len(), inputs.len());
+        for (input, result) in inputs.iter().zip(&results) {
+            match USER_ADDRESSES.iter().find(|(user, _)| input.starts_with(&format!("{}@", user))) {
+                Some((_, address)) => assert!(result.as_ref().unwrap().uri.contains(address), "{}", input),
+                None => assert!(matches!(result, Err(Bip353Error::InvalidAddress(_))), "{}", input),
+            }
+        }
+        
+        // Each distinct name reaches the backend exactly once
+        let lookups = resolver.hrn_resolver().0.lock().unwrap().clone();
+        assert_eq!(lookups.len(), 3);
+        assert!(lookups.values().all(|&count| count == 1), "{:?}", lookups);
+        
+        assert!(resolver.resolve_many::<&str>(&[], 4).await.is_empty());
+    }
+    
+    #[tokio::test]
+    async fn test_failures_counted_by_kind() {
+        let config = ResolverConfig::default().with_metrics(true);
+        let resolver = Bip353Resolver::with_hrn_resolver(CountingResolver(Default::default()), config);
+        
+        let _ = resolver.resolve_address("not-an-address").await;
+        let _ = resolver.resolve_address("alice@example.com").await;
+        
+        let metrics = resolver.metrics().unwrap();
+        let failures = metrics.get_failure_stats();
+        assert_eq!(failures.get(crate::ErrorKind::InvalidAddress), 1);
+        assert_eq!(failures.get(crate::ErrorKind::Dns), 1);
+        assert_eq!(metrics.get_resolution_stats().failed, 2);
+    }
+    
+    #[tokio::test]
+    async fn test_cache_evicts_oldest() {
+        let resolver = Bip353Resolver::with_hrn_resolver(SlowResolver { delay: Duration::ZERO }, ResolverConfig::default());
+        let info = resolver.resolve("alice", "example.com").await.unwrap();
+        
+        let cache = AddressCache::new(Duration::from_secs(60), 2);
+        cache.insert("a@example.com", info.clone());
+        cache.insert("b@example.com", info.clone());
+        // Replacing an entry moves it to the back
+        cache.insert("a@example.com", info.clone());
+        cache.insert("c@example.com", info.clone());
+        assert_eq!(cache.len(), 2);
+        assert!(cache.with_entry("b@example.com", |_| ()).is_none());
+        assert!(cache.with_entry("a@example.com", |_| ()).is_some());
+        
+        // Invalidated entries free their slot
+        cache.invalidate("a@example.com");
+        cache.insert("d@example.com", info.clone());
+        assert!(cache.with_entry("c@example.com", |_| ()).is_some());
+        
+        // Stale positions are compacted rather than piling up
+        for _ in 0..1000 {
+            cache.insert("d@example.com", info.clone());
+        }
+        assert!(cache.order_len() <= 2 * 2 + 16);
+        
+        // Expired entries go first, even when unbounded
+        let cache = AddressCache::new(Duration::from_millis(10), 0);
+        cache.insert("a@example.com", info.clone());
+        std::thread::sleep(Duration::from_millis(20));
+        cache.insert("b@example.com", info);
+        assert_eq!(cache.len(), 1);
+    }
+    
+    #[tokio::test]
+    async fn test_cache_fill() {
+        let config = ResolverConfig::default().with_cache_ttl(Duration::from_secs(60)).with_metrics(true);
+        let resolver = Arc::new(Bip353Resolver::with_hrn_resolver(SlowResolver { delay: Duration::from_millis(20) }, config));
+        assert!(resolver.with_cached("alice@example.com", PaymentInfo::clone).is_none());
+        
+        // Only one fill per name runs at a time
+        let fill = resolver.cache_fill("alice", "example.com").unwrap();
+        assert!(resolver.cache_fill("alice", "example.com").is_none());
+        fill.await;
+        
+        assert!(resolver.try_resolve_cached("alice", "example.com").is_some());
+        let stats = resolver.metrics().unwrap().get_cache_stats();
+        assert_eq!((stats.hits, stats.misses), (1, 1));
+        
+        // A finished fill releases its claim
+        assert!(resolver.cache_fill("alice", "example.com").is_some());
+    }
+    
+    #[test]
+    fn test_try_resolve_cached_miss() {
+        // Without a cache every probe is a miss
+        let resolver = Bip353Resolver::new().unwrap();
+        assert!(resolver.try_resolve_cached("alice", "example.com").is_none());
+        
+        let resolver = Bip353Resolver::with_enhanced_config(
+            ResolverConfig::default(),
+            true,
+            Duration::from_secs(300),
+            true,
+        ).unwrap();
+        assert!(resolver.try_resolve_cached("alice", "example.com").is_none());
+        assert_eq!(resolver.metrics.as_ref().unwrap().get_cache_stats().misses, 1);
+    }
 }
\ No newline at end of file
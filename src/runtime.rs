@@ -0,0 +1,29 @@
+//! Tokio runtime construction shared by the FFI and Python bindings
+
+use std::sync::atomic::{AtomicUsize, Ordering};
+use tokio::runtime::{Builder, Runtime};
+
+/// Worker threads used when a binding creates its runtime implicitly.
+/// Resolution is I/O bound, so a couple of workers are enough for most hosts.
+pub(crate) const DEFAULT_WORKER_THREADS: usize = 2;
+
+/// Thread name prefix used when none is given
+pub(crate) const DEFAULT_THREAD_NAME_PREFIX: &str = "bip353";
+
+/// Build a runtime with numbered worker threads ("prefix-0", "prefix-1", ...)
+pub(crate) fn build_runtime(worker_threads: usize, thread_name_prefix: &str, current_thread: bool) -> std::io::Result<Runtime> {
+    let mut builder = if current_thread {
+        Builder::new_current_thread()
+    } else {
+        let mut builder = Builder::new_multi_thread();
+        builder.worker_threads(worker_threads.max(1));
+        builder
+    };
+    
+    let prefix = thread_name_prefix.to_string();
+    let thread_id = AtomicUsize::new(0);
+    builder
+        .enable_all()
+        .thread_name_fn(move || format!("{}-{}", prefix, thread_id.fetch_add(1, Ordering::Relaxed)))
+        .build()
+}
@@ -0,0 +1,187 @@
+//! Validating HRN resolver for `DnsServer`
+
+use std::io::{self, Read, Write};
+use std::net::{SocketAddr, TcpStream, UdpSocket};
+use std::sync::atomic::{AtomicU16, Ordering};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+use bitcoin_payment_instructions::amount::Amount;
+use bitcoin_payment_instructions::hrn_resolution::{
+    HrnResolution,
+    HrnResolutionFuture,
+    HrnResolver,
+    HumanReadableName,
+    LNURLResolutionFuture,
+};
+
+use super::wire::{txt_text, Message, Name, Record, RCODE_NXDOMAIN, TYPE_DNSKEY, TYPE_DS, TYPE_RRSIG, TYPE_TXT};
+use super::zone::{anchor_matches, ds_matches, verify, TrustAnchor};
+
+static NEXT_ID: AtomicU16 = AtomicU16::new(1);
+
+/// HRN resolver that queries a `DnsServer` and validates its answers up to
+/// the server's trust anchor
+///
+/// Queries go over UDP, are retried on timeout and repeated over TCP when a
+/// response is truncated. Each resolution runs on tokio's blocking pool.
+/// The proof returned with a resolution is every record of the chain in
+/// wire format. LNURL is not supported.
+#[derive(Debug, Clone)]
+pub struct LocalHrnResolver {
+    server: SocketAddr,
+    trust_anchor: TrustAnchor,
+    timeout: Duration,
+    attempts: u32,
+}
+
+impl LocalHrnResolver {
+    pub fn new(server: SocketAddr, trust_anchor: TrustAnchor) -> Self {
+        Self {
+            server,
+            trust_anchor,
+            timeout: Duration::from_millis(200),
+            attempts: 3,
+        }
+    }
+    
+    /// Wait `timeout` for each UDP response, sending each query up to `attempts` times
+    pub fn with_timeout(mut self, timeout: Duration, attempts: u32) -> Self {
+        self.timeout = timeout;
+        self.attempts = attempts.max(1);
+        self
+    }
+    
+    /// Resolve and validate the payment record of `user@domain`, blocking
+    pub fn resolve_blocking(&self, user: &str, domain: &str) -> Result<HrnResolution, &'static str> {
+        let name = Name::parse(&format!("{}.user._bitcoin-payment.{}", user, domain)).ok_or("invalid name")?;
+        let socket = UdpSocket::bind("127.0.0.1:0").map_err(|_| "failed to open a UDP socket")?;
+        socket.connect(self.server).map_err(|_| "failed to reach the DNS server")?;
+        socket.set_read_timeout(Some(self.timeout)).map_err(|_| "failed to set a timeout")?;
+        
+        let answers = self.query(&socket, &name, TYPE_TXT)?;
+        let (txt, sig) = split_rrset(&answers, TYPE_TXT);
+        let mut records: Vec<&str> = Vec::new();
+        let texts: Vec<String> = txt.iter().filter_map(|record| txt_text(&record.rdata)).collect();
+        for text in &texts {
+            if text.len() >= 8 && text[..8].eq_ignore_ascii_case("bitcoin:") {
+                records.push(text);
+            }
+        }
+        let result = match records.as_slice() {
+            [record] => record.to_string(),
+            [] => return Err("no payment instructions record"),
+            _ => return Err("more than one payment instructions record"),
+        };
+        
+        let mut proof = Vec::new();
+        self.validate(&socket, txt, sig.ok_or("unsigned TXT record")?, &mut proof)?;
+        Ok(HrnResolution::DNSSEC { proof: Some(proof), result })
+    }
+    
+    /// Follow signatures from `rrset` up to the root, appending every record to `proof`
+    fn validate(&self, socket: &UdpSocket, mut rrset: Vec<Record>, mut sig: Record, proof: &mut Vec<u8>) -> Result<(), &'static str> {
+        let now = SystemTime::now().duration_since(UNIX_EPOCH).unwrap_or_default().as_secs() as u32;
+        loop {
+            let mut pos = 18;
+            let signer = Name::read(&sig.rdata, &mut pos).ok_or("malformed RRSIG")?;
+            let answers = self.query(socket, &signer, TYPE_DNSKEY)?;
+            let (keys, key_sig) = split_rrset(&answers, TYPE_DNSKEY);
+            verify(&keys, key_sig.as_ref().ok_or("unsigned DNSKEY")?, &keys, now)?;
+            verify(&rrset, &sig, &keys, now)?;
+            
+            for record in rrset.iter().chain([&sig]).chain(&keys).chain(&key_sig) {
+                record.write(proof);
+            }
+            
+            if signer.is_root() {
+                return if anchor_matches(&self.trust_anchor, &keys) { Ok(()) } else { Err("root key does not match the trust anchor") };
+            }
+            
+            let answers = self.query(socket, &signer, TYPE_DS)?;
+            let (ds, ds_sig) = split_rrset(&answers, TYPE_DS);
+            if !ds.iter().any(|ds| ds_matches(ds, &keys)) {
+                return Err("no DS record matches the zone key");
+            }
+            rrset = ds;
+            sig = ds_sig.ok_or("unsigned DS")?;
+        }
+    }
+    
+    /// Answers to one query, over UDP with retries, then TCP if truncated
+    fn query(&self, socket: &UdpSocket, name: &Name, rtype: u16) -> Result<Vec<Record>, &'static str> {
+        let id = NEXT_ID.fetch_add(1, Ordering::Relaxed);
+        let query = Message::query(id, name.clone(), rtype).encode();
+        let mut buf = [0u8; 65535];
+        
+        let mut response = None;
+        'attempts: for _ in 0..self.attempts {
+            socket.send(&query).map_err(|_| "failed to send a DNS query")?;
+            // Skip late responses to earlier attempts or queries
+            loop {
+                let len = match socket.recv(&mut buf) {
+                    Ok(len) => len,
+                    Err(e) if matches!(e.kind(), io::ErrorKind::WouldBlock | io::ErrorKind::TimedOut) => continue 'attempts,
+                    Err(_) => return Err("failed to receive a DNS response"),
+                };
+                if let Some(message) = Message::decode(&buf[..len]).filter(|m| m.id == id && m.is_response()) {
+                    response = Some(message);
+                    break 'attempts;
+                }
+            }
+        }
+        
+        let mut response = response.ok_or("DNS query timed out")?;
+        if response.is_truncated() {
+            response = self.query_tcp(&query).map_err(|_| "DNS query over TCP failed")?;
+        }
+        match response.rcode() {
+            0 => Ok(response.answers),
+            RCODE_NXDOMAIN => Err("no such name"),
+            _ => Err("DNS server returned an error"),
+        }
+    }
+    
+    fn query_tcp(&self, query: &[u8]) -> io::Result<Message> {
+        let mut stream = TcpStream::connect_timeout(&self.server, self.timeout)?;
+        stream.set_read_timeout(Some(self.timeout * self.attempts))?;
+        stream.set_nodelay(true)?;
+        let mut framed = (query.len() as u16).to_be_bytes().to_vec();
+        framed.extend_from_slice(query);
+        stream.write_all(&framed)?;
+        
+        let mut len = [0u8; 2];
+        stream.read_exact(&mut len)?;
+        let mut response = vec![0u8; u16::from_be_bytes(len) as usize];
+        stream.read_exact(&mut response)?;
+        Message::decode(&response).ok_or_else(|| io::Error::new(io::ErrorKind::InvalidData, "malformed DNS response"))
+    }
+}
+
+/// Records of `rtype` and the RRSIG covering them
+fn split_rrset(answers: &[Record], rtype: u16) -> (Vec<Record>, Option<Record>) {
+    let rrset = answers.iter().filter(|record| record.rtype == rtype).cloned().collect();
+    let sig = answers.iter()
+        .find(|record| record.rtype == TYPE_RRSIG && record.rdata.get(..2) == Some(&rtype.to_be_bytes()[..]))
+        .cloned();
+    (rrset, sig)
+}
+
+impl HrnResolver for LocalHrnResolver {
+    fn resolve_hrn<'a>(&'a self, hrn: &'a HumanReadableName) -> HrnResolutionFuture<'a> {
+        let resolver = self.clone();
+        let (user, domain) = (hrn.user().to_string(), hrn.domain().to_string());
+        Box::pin(async move {
+            tokio::task::spawn_blocking(move || resolver.resolve_blocking(&user, &domain))
+                .await
+                .map_err(|_| "resolution task failed")?
+        })
+    }
+    
+    fn resolve_lnurl<'a>(&'a self, _url: &'a str) -> HrnResolutionFuture<'a> {
+        Box::pin(async { Err("LNURL is not supported by the local resolver") })
+    }
+    
+    fn resolve_lnurl_to_invoice<'a>(&'a self, _: String, _: Amount, _: [u8; 32]) -> LNURLResolutionFuture<'a> {
+        Box::pin(async { Err("LNURL is not supported by the local resolver") })
+    }
+}
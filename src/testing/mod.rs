@@ -0,0 +1,22 @@
+//! Local stand-in DNS server for tests and benchmarks (`testing` feature)
+//!
+//! `DnsServer` serves a signed hierarchy (a root, its top-level domains and
+//! the configured domains) over UDP and TCP on localhost, with configurable
+//! latency, UDP loss and truncation. Users are generated on demand, so a
+//! zone can hold millions of them. `LocalHrnResolver` validates each answer
+//! up to the server's own trust anchor, so resolutions can be tested and
+//! benchmarked end to end without network access.
+//!
+//! dnssec-prover only accepts chains to the IANA root keys, so zones are
+//! signed with the private DNSSEC algorithm 253 and an HMAC standing in for
+//! public-key signatures. The built-in DNS resolvers cannot validate these
+//! zones; use `DnsServer::resolver` instead.
+
+mod client;
+mod server;
+mod wire;
+mod zone;
+
+pub use client::LocalHrnResolver;
+pub use server::{DnsServer, DnsServerConfig, DnsServerStats};
+pub use zone::{TrustAnchor, ZoneConfig, DEFAULT_RECORD};
@@ -0,0 +1,294 @@
+//! Stand-in authoritative DNS server on localhost
+//!
+//! UDP and TCP share one port on 127.0.0.1. Queries are answered from
+//! `Zones` on plain threads, so the server needs no runtime and can back
+//! synchronous tests, benchmarks and the C API alike.
+
+use std::io::{self, Read, Write};
+use std::net::{SocketAddr, TcpListener, TcpStream, UdpSocket};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::mpsc;
+use std::sync::Arc;
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+use super::client::LocalHrnResolver;
+use super::wire::{Message, RCODE_FORMERR, RCODE_NXDOMAIN};
+use super::zone::{TrustAnchor, ZoneConfig, Zones};
+
+/// Largest UDP response without EDNS (RFC 1035 4.2.1)
+const MAX_UDP_PAYLOAD: usize = 512;
+/// How long an idle TCP connection is kept open
+const TCP_IDLE_TIMEOUT: Duration = Duration::from_secs(10);
+
+/// Zones and network conditions of a `DnsServer`
+#[derive(Debug, Clone)]
+pub struct DnsServerConfig {
+    pub zones: ZoneConfig,
+    /// Delay before every response, over UDP and TCP
+    pub latency: Duration,
+    /// Fraction of UDP queries dropped without a response, from 0.0 to 1.0
+    pub udp_loss: f64,
+    /// UDP responses larger than this are truncated, so clients retry over TCP
+    pub max_udp_payload: usize,
+    /// Seed of the loss pattern, so that lossy runs repeat
+    pub seed: u64,
+}
+
+impl Default for DnsServerConfig {
+    fn default() -> Self {
+        Self {
+            zones: ZoneConfig::default(),
+            latency: Duration::ZERO,
+            udp_loss: 0.0,
+            max_udp_payload: MAX_UDP_PAYLOAD,
+            seed: 0,
+        }
+    }
+}
+
+impl DnsServerConfig {
+    pub fn with_latency(mut self, latency: Duration) -> Self {
+        self.latency = latency;
+        self
+    }
+    
+    pub fn with_udp_loss(mut self, udp_loss: f64) -> Self {
+        self.udp_loss = udp_loss;
+        self
+    }
+    
+    pub fn with_max_udp_payload(mut self, max_udp_payload: usize) -> Self {
+        self.max_udp_payload = max_udp_payload;
+        self
+    }
+}
+
+/// Query counts of a `DnsServer`
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct DnsServerStats {
+    pub udp_queries: u64,
+    pub tcp_queries: u64,
+    /// UDP queries dropped to simulate loss
+    pub dropped: u64,
+    /// UDP responses sent truncated
+    pub truncated: u64,
+}
+
+#[derive(Default)]
+struct Counters {
+    udp_queries: AtomicU64,
+    tcp_queries: AtomicU64,
+    dropped: AtomicU64,
+    truncated: AtomicU64,
+}
+
+struct Shared {
+    zones: Zones,
+    latency: Duration,
+    udp_loss: f64,
+    max_udp_payload: usize,
+    rng: AtomicU64,
+    counters: Counters,
+    shutdown: AtomicBool,
+}
+
+impl Shared {
+    /// Wire response to a wire query, None if the query cannot be parsed
+    fn respond(&self, query: &[u8]) -> Option<Message> {
+        let query = Message::decode(query).filter(|query| !query.is_response())?;
+        let Some((name, rtype)) = &query.question else {
+            return Some(Message::response(&query, RCODE_FORMERR, Vec::new()));
+        };
+        Some(match self.zones.answer(name, *rtype) {
+            Some(answers) => Message::response(&query, 0, answers),
+            None => Message::response(&query, RCODE_NXDOMAIN, Vec::new()),
+        })
+    }
+    
+    /// Whether to drop the next UDP query, from a SplitMix64 sequence
+    fn lost(&self) -> bool {
+        if self.udp_loss <= 0.0 {
+            return false;
+        }
+        let mut z = self.rng.fetch_add(0x9e37_79b9_7f4a_7c15, Ordering::Relaxed);
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+        z ^= z >> 31;
+        ((z >> 11) as f64 / (1u64 << 53) as f64) < self.udp_loss
+    }
+}
+
+/// DNS server for the zones of a `ZoneConfig`, stopped on drop
+///
+/// ```no_run
+/// use bip353::testing::{DnsServer, DnsServerConfig};
+/// use bip353::{Bip353Resolver, ResolverConfig};
+///
+/// let server = DnsServer::start(DnsServerConfig::default()).unwrap();
+/// let resolver = Bip353Resolver::with_hrn_resolver(server.resolver(), ResolverConfig::default());
+/// ```
+pub struct DnsServer {
+    addr: SocketAddr,
+    trust_anchor: TrustAnchor,
+    shared: Arc<Shared>,
+    threads: Vec<JoinHandle<()>>,
+}
+
+impl DnsServer {
+    /// Sign the zones and start serving on an ephemeral localhost port
+    pub fn start(config: DnsServerConfig) -> io::Result<Self> {
+        let zones = Zones::new(&config.zones)
+            .ok_or_else(|| io::Error::new(io::ErrorKind::InvalidInput, "invalid domain or record name"))?;
+        let trust_anchor = zones.trust_anchor();
+        let (udp, tcp) = bind_pair()?;
+        let addr = udp.local_addr()?;
+        
+        let shared = Arc::new(Shared {
+            zones,
+            latency: config.latency,
+            udp_loss: config.udp_loss,
+            max_udp_payload: config.max_udp_payload,
+            rng: AtomicU64::new(config.seed),
+            counters: Counters::default(),
+            shutdown: AtomicBool::new(false),
+        });
+        
+        // Delayed UDP responses leave in arrival order, as every delay is the same
+        let (delayed, queue) = mpsc::channel::<(Instant, Vec<u8>, SocketAddr)>();
+        let sender = udp.try_clone()?;
+        let threads = vec![
+            spawn("bip353-dns-udp", {
+                let shared = shared.clone();
+                move || serve_udp(&shared, &udp, &delayed)
+            })?,
+            spawn("bip353-dns-delay", move || {
+                for (due, response, peer) in queue {
+                    thread::sleep(due.saturating_duration_since(Instant::now()));
+                    let _ = sender.send_to(&response, peer);
+                }
+            })?,
+            spawn("bip353-dns-tcp", {
+                let shared = shared.clone();
+                move || serve_tcp(&shared, &tcp)
+            })?,
+        ];
+        
+        Ok(DnsServer { addr, trust_anchor, shared, threads })
+    }
+    
+    /// Address of both the UDP and the TCP listener
+    pub fn addr(&self) -> SocketAddr {
+        self.addr
+    }
+    
+    /// Root key of the served hierarchy
+    pub fn trust_anchor(&self) -> TrustAnchor {
+        self.trust_anchor
+    }
+    
+    pub fn stats(&self) -> DnsServerStats {
+        let counters = &self.shared.counters;
+        DnsServerStats {
+            udp_queries: counters.udp_queries.load(Ordering::Relaxed),
+            tcp_queries: counters.tcp_queries.load(Ordering::Relaxed),
+            dropped: counters.dropped.load(Ordering::Relaxed),
+            truncated: counters.truncated.load(Ordering::Relaxed),
+        }
+    }
+    
+    /// Validating HRN resolver for this server and its trust anchor
+    pub fn resolver(&self) -> LocalHrnResolver {
+        LocalHrnResolver::new(self.addr, self.trust_anchor)
+    }
+}
+
+impl Drop for DnsServer {
+    fn drop(&mut self) {
+        self.shared.shutdown.store(true, Ordering::Relaxed);
+        // Wake both blocking listeners so they see the flag
+        if let Ok(socket) = UdpSocket::bind("127.0.0.1:0") {
+            let _ = socket.send_to(&[], self.addr);
+        }
+        let _ = TcpStream::connect(self.addr);
+        for thread in self.threads.drain(..) {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// UDP and TCP listeners on the same free port
+fn bind_pair() -> io::Result<(UdpSocket, TcpListener)> {
+    let mut last = None;
+    for _ in 0..16 {
+        let udp = UdpSocket::bind("127.0.0.1:0")?;
+        match TcpListener::bind(udp.local_addr()?) {
+            Ok(tcp) => return Ok((udp, tcp)),
+            Err(e) => last = Some(e),
+        }
+    }
+    Err(last.unwrap_or_else(|| io::Error::new(io::ErrorKind::AddrInUse, "no free port")))
+}
+
+fn spawn(name: &str, f: impl FnOnce() + Send + 'static) -> io::Result<JoinHandle<()>> {
+    thread::Builder::new().name(name.to_string()).spawn(f)
+}
+
+fn serve_udp(shared: &Shared, socket: &UdpSocket, delayed: &mpsc::Sender<(Instant, Vec<u8>, SocketAddr)>) {
+    let mut buf = [0u8; 65535];
+    while !shared.shutdown.load(Ordering::Relaxed) {
+        let Ok((len, peer)) = socket.recv_from(&mut buf) else { continue };
+        let counters = &shared.counters;
+        counters.udp_queries.fetch_add(1, Ordering::Relaxed);
+        if shared.lost() {
+            counters.dropped.fetch_add(1, Ordering::Relaxed);
+            continue;
+        }
+        let Some(response) = shared.respond(&buf[..len]) else { continue };
+        
+        let mut encoded = response.encode();
+        if encoded.len() > shared.max_udp_payload {
+            counters.truncated.fetch_add(1, Ordering::Relaxed);
+            encoded = response.truncated().encode();
+        }
+        if shared.latency.is_zero() {
+            let _ = socket.send_to(&encoded, peer);
+        } else {
+            let _ = delayed.send((Instant::now() + shared.latency, encoded, peer));
+        }
+    }
+}
+
+fn serve_tcp(shared: &Arc<Shared>, listener: &TcpListener) {
+    for stream in listener.incoming() {
+        if shared.shutdown.load(Ordering::Relaxed) {
+            break;
+        }
+        let Ok(stream) = stream else { continue };
+        let shared = shared.clone();
+        let _ = spawn("bip353-dns-conn", move || {
+            let _ = serve_connection(&shared, stream);
+        });
+    }
+}
+
+/// Answer length-prefixed queries until the client closes the connection
+fn serve_connection(shared: &Shared, mut stream: TcpStream) -> io::Result<()> {
+    stream.set_read_timeout(Some(TCP_IDLE_TIMEOUT))?;
+    stream.set_nodelay(true)?;
+    loop {
+        let mut len = [0u8; 2];
+        stream.read_exact(&mut len)?;
+        let mut query = vec![0u8; u16::from_be_bytes(len) as usize];
+        stream.read_exact(&mut query)?;
+        shared.counters.tcp_queries.fetch_add(1, Ordering::Relaxed);
+        
+        let Some(response) = shared.respond(&query) else { return Ok(()) };
+        thread::sleep(shared.latency);
+        let encoded = response.encode();
+        let mut framed = Vec::with_capacity(encoded.len() + 2);
+        framed.extend_from_slice(&(encoded.len() as u16).to_be_bytes());
+        framed.extend_from_slice(&encoded);
+        stream.write_all(&framed)?;
+    }
+}
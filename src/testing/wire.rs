@@ -0,0 +1,291 @@
+//! DNS wire format (RFC 1035, RFC 4034), as much as the stand-in server and
+//! its resolver use
+
+use std::fmt;
+
+pub(crate) const CLASS_IN: u16 = 1;
+pub(crate) const TYPE_TXT: u16 = 16;
+pub(crate) const TYPE_DS: u16 = 43;
+pub(crate) const TYPE_RRSIG: u16 = 46;
+pub(crate) const TYPE_DNSKEY: u16 = 48;
+
+pub(crate) const RCODE_FORMERR: u16 = 1;
+pub(crate) const RCODE_NXDOMAIN: u16 = 3;
+
+const FLAG_QR: u16 = 0x8000;
+const FLAG_AA: u16 = 0x0400;
+const FLAG_TC: u16 = 0x0200;
+const FLAG_RD: u16 = 0x0100;
+const FLAG_RA: u16 = 0x0080;
+
+/// Domain name as lowercase labels; the root has none
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub(crate) struct Name(Vec<String>);
+
+impl Name {
+    pub(crate) fn root() -> Self {
+        Name(Vec::new())
+    }
+    
+    /// Parse a dotted name, with or without the trailing dot
+    pub(crate) fn parse(text: &str) -> Option<Self> {
+        let text = text.strip_suffix('.').unwrap_or(text);
+        if text.is_empty() {
+            return Some(Self::root());
+        }
+        let labels: Vec<String> = text.split('.').map(str::to_ascii_lowercase).collect();
+        if labels.iter().any(|label| label.is_empty() || label.len() > 63) {
+            return None;
+        }
+        Some(Name(labels))
+    }
+    
+    pub(crate) fn is_root(&self) -> bool {
+        self.0.is_empty()
+    }
+    
+    /// Number of labels, as in the RRSIG labels field
+    pub(crate) fn labels(&self) -> u8 {
+        self.0.len() as u8
+    }
+    
+    /// The name with its first label removed, None for the root
+    pub(crate) fn parent(&self) -> Option<Self> {
+        (!self.is_root()).then(|| Name(self.0[1..].to_vec()))
+    }
+    
+    /// Whether this name is `zone` or below it
+    pub(crate) fn is_within(&self, zone: &Name) -> bool {
+        self.0.ends_with(&zone.0)
+    }
+    
+    /// Uncompressed wire form, which is also the canonical form
+    pub(crate) fn write(&self, out: &mut Vec<u8>) {
+        for label in &self.0 {
+            out.push(label.len() as u8);
+            out.extend_from_slice(label.as_bytes());
+        }
+        out.push(0);
+    }
+    
+    pub(crate) fn to_wire(&self) -> Vec<u8> {
+        let mut out = Vec::new();
+        self.write(&mut out);
+        out
+    }
+    
+    /// Read a possibly compressed name from `msg` at `pos`, advancing `pos`
+    pub(crate) fn read(msg: &[u8], pos: &mut usize) -> Option<Self> {
+        let mut labels = Vec::new();
+        let mut cursor = *pos;
+        let mut jumped = false;
+        for _ in 0..128 {
+            let len = *msg.get(cursor)? as usize;
+            if len & 0xc0 == 0xc0 {
+                let target = (len & 0x3f) << 8 | *msg.get(cursor + 1)? as usize;
+                if !jumped {
+                    *pos = cursor + 2;
+                    jumped = true;
+                }
+                cursor = target;
+                continue;
+            }
+            cursor += 1;
+            if len == 0 {
+                if !jumped {
+                    *pos = cursor;
+                }
+                return Some(Name(labels));
+            }
+            let label = msg.get(cursor..cursor + len)?;
+            labels.push(String::from_utf8_lossy(label).to_ascii_lowercase());
+            cursor += len;
+        }
+        None
+    }
+}
+
+impl fmt::Display for Name {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        if self.is_root() {
+            return f.write_str(".");
+        }
+        for label in &self.0 {
+            write!(f, "{}.", label)?;
+        }
+        Ok(())
+    }
+}
+
+/// One resource record of class IN
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) struct Record {
+    pub(crate) name: Name,
+    pub(crate) rtype: u16,
+    pub(crate) ttl: u32,
+    pub(crate) rdata: Vec<u8>,
+}
+
+impl Record {
+    pub(crate) fn write(&self, out: &mut Vec<u8>) {
+        self.name.write(out);
+        out.extend_from_slice(&self.rtype.to_be_bytes());
+        out.extend_from_slice(&CLASS_IN.to_be_bytes());
+        out.extend_from_slice(&self.ttl.to_be_bytes());
+        out.extend_from_slice(&(self.rdata.len() as u16).to_be_bytes());
+        out.extend_from_slice(&self.rdata);
+    }
+    
+    fn read(msg: &[u8], pos: &mut usize) -> Option<Self> {
+        let name = Name::read(msg, pos)?;
+        let fixed = msg.get(*pos..*pos + 10)?;
+        let rtype = u16::from_be_bytes([fixed[0], fixed[1]]);
+        let ttl = u32::from_be_bytes([fixed[4], fixed[5], fixed[6], fixed[7]]);
+        let len = u16::from_be_bytes([fixed[8], fixed[9]]) as usize;
+        *pos += 10;
+        let rdata = msg.get(*pos..*pos + len)?.to_vec();
+        *pos += len;
+        Some(Record { name, rtype, ttl, rdata })
+    }
+}
+
+/// TXT rdata holding `text`, split into character-strings of up to 255 bytes
+pub(crate) fn txt_rdata(text: &str) -> Vec<u8> {
+    let mut rdata = Vec::with_capacity(text.len() + text.len() / 255 + 1);
+    for chunk in text.as_bytes().chunks(255) {
+        rdata.push(chunk.len() as u8);
+        rdata.extend_from_slice(chunk);
+    }
+    rdata
+}
+
+/// Concatenated character-strings of TXT rdata
+pub(crate) fn txt_text(rdata: &[u8]) -> Option<String> {
+    let mut text = Vec::with_capacity(rdata.len());
+    let mut pos = 0;
+    while pos < rdata.len() {
+        let len = rdata[pos] as usize;
+        text.extend_from_slice(rdata.get(pos + 1..pos + 1 + len)?);
+        pos += 1 + len;
+    }
+    String::from_utf8(text).ok()
+}
+
+/// A query or response with at most one question
+///
+/// Authority and additional sections are neither sent nor read.
+#[derive(Debug, Clone)]
+pub(crate) struct Message {
+    pub(crate) id: u16,
+    pub(crate) flags: u16,
+    pub(crate) question: Option<(Name, u16)>,
+    pub(crate) answers: Vec<Record>,
+}
+
+impl Message {
+    pub(crate) fn query(id: u16, name: Name, rtype: u16) -> Self {
+        Message { id, flags: FLAG_RD, question: Some((name, rtype)), answers: Vec::new() }
+    }
+    
+    /// Authoritative response to `query` with `rcode`
+    pub(crate) fn response(query: &Message, rcode: u16, answers: Vec<Record>) -> Self {
+        Message {
+            id: query.id,
+            flags: FLAG_QR | FLAG_AA | FLAG_RA | (query.flags & FLAG_RD) | rcode,
+            question: query.question.clone(),
+            answers,
+        }
+    }
+    
+    /// The same response without answers and with TC set, for UDP size limits
+    pub(crate) fn truncated(&self) -> Self {
+        Message {
+            flags: self.flags | FLAG_TC,
+            answers: Vec::new(),
+            ..self.clone()
+        }
+    }
+    
+    pub(crate) fn is_truncated(&self) -> bool {
+        self.flags & FLAG_TC != 0
+    }
+    
+    pub(crate) fn is_response(&self) -> bool {
+        self.flags & FLAG_QR != 0
+    }
+    
+    pub(crate) fn rcode(&self) -> u16 {
+        self.flags & 0x000f
+    }
+    
+    pub(crate) fn encode(&self) -> Vec<u8> {
+        let mut out = Vec::with_capacity(512);
+        out.extend_from_slice(&self.id.to_be_bytes());
+        out.extend_from_slice(&self.flags.to_be_bytes());
+        out.extend_from_slice(&(self.question.is_some() as u16).to_be_bytes());
+        out.extend_from_slice(&(self.answers.len() as u16).to_be_bytes());
+        out.extend_from_slice(&[0; 4]);
+        if let Some((name, rtype)) = &self.question {
+            name.write(&mut out);
+            out.extend_from_slice(&rtype.to_be_bytes());
+            out.extend_from_slice(&CLASS_IN.to_be_bytes());
+        }
+        for record in &self.answers {
+            record.write(&mut out);
+        }
+        out
+    }
+    
+    pub(crate) fn decode(msg: &[u8]) -> Option<Self> {
+        let header = msg.get(..12)?;
+        let field = |i: usize| u16::from_be_bytes([header[i], header[i + 1]]);
+        let (questions, answers) = (field(4), field(6));
+        if questions > 1 {
+            return None;
+        }
+        
+        let mut pos = 12;
+        let question = if questions == 1 {
+            let name = Name::read(msg, &mut pos)?;
+            let rtype = msg.get(pos..pos + 4)?;
+            pos += 4;
+            Some((name, u16::from_be_bytes([rtype[0], rtype[1]])))
+        } else {
+            None
+        };
+        let answers = (0..answers).map(|_| Record::read(msg, &mut pos)).collect::<Option<_>>()?;
+        
+        Some(Message { id: field(0), flags: field(2), question, answers })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    
+    #[test]
+    fn test_message_round_trip() {
+        let name = Name::parse("Alice.user._bitcoin-payment.example.com.").unwrap();
+        assert_eq!(name.to_string(), "alice.user._bitcoin-payment.example.com.");
+        assert!(name.is_within(&Name::parse("example.com").unwrap()));
+        assert!(name.is_within(&Name::root()));
+        
+        let query = Message::query(7, name.clone(), TYPE_TXT);
+        let text = "bitcoin:".to_string() + &"x".repeat(300);
+        let record = Record { name, rtype: TYPE_TXT, ttl: 60, rdata: txt_rdata(&text) };
+        let response = Message::response(&query, 0, vec![record.clone()]);
+        
+        let decoded = Message::decode(&response.encode()).unwrap();
+        assert_eq!(decoded.id, 7);
+        assert!(decoded.is_response() && !decoded.is_truncated());
+        assert_eq!(decoded.answers, vec![record]);
+        assert_eq!(txt_text(&decoded.answers[0].rdata).unwrap(), text);
+        
+        // A compression pointer to the question name
+        let mut msg = Message::query(1, Name::parse("example.com").unwrap(), TYPE_TXT).encode();
+        msg[7] = 1;
+        msg.extend_from_slice(&[0xc0, 12, 0, 16, 0, 1, 0, 0, 0, 60, 0, 2, 1, b'a']);
+        let decoded = Message::decode(&msg).unwrap();
+        assert_eq!(decoded.answers[0].name, Name::parse("example.com").unwrap());
+    }
+}
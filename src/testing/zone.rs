@@ -0,0 +1,328 @@
+//! Locally signed zone hierarchy served by `DnsServer`
+//!
+//! Every configured domain is a zone delegated from its top-level domain,
+//! which is delegated from a local root. Each zone has one key, and every
+//! RRset is signed as in RFC 4034. DNSKEY, DS and their signatures are made
+//! once; user records and their signatures are made on each query, so a zone
+//! can hold any number of users.
+//!
+//! The signature algorithm is the private algorithm 253 (RFC 4034 A.1.1)
+//! with HMAC-SHA256 standing in for a public-key signature. The DNSKEY
+//! carries the HMAC key, so the signatures only prove integrity between the
+//! fixture and `LocalHrnResolver`. They are not a security mechanism.
+
+use std::collections::HashMap;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+use bitcoin::hashes::{sha256, Hash, HashEngine, Hmac, HmacEngine};
+
+use super::wire::{txt_rdata, Name, Record, TYPE_DNSKEY, TYPE_DS, TYPE_RRSIG, TYPE_TXT};
+
+/// Private DNSSEC algorithm number, identified by `ALGORITHM_NAME`
+const ALGORITHM: u8 = 253;
+/// Name prefixed to private-algorithm keys and signatures
+const ALGORITHM_NAME: &str = "hmac-sha256.bip353.invalid.";
+const DIGEST_SHA256: u8 = 2;
+/// Zone key, secure entry point (RFC 4034 2.1.1)
+const KEY_FLAGS: u16 = 257;
+
+/// Record every generated user resolves to
+pub const DEFAULT_RECORD: &str = "bitcoin:bc1qar0srrr7xfkvy5l643lydnw9re59gtzzwf5mdq";
+
+/// Domains served by a `DnsServer` and their users
+#[derive(Debug, Clone)]
+pub struct ZoneConfig {
+    /// Domains holding BIP-353 records, such as "example.com"
+    pub domains: Vec<String>,
+    /// Users "user0" to "user{users - 1}" of every domain, generated on demand
+    pub users: u64,
+    /// Record of every generated user
+    pub record: String,
+    /// Further names with their own records, as ("alice@example.com", "bitcoin:...")
+    pub records: Vec<(String, String)>,
+    /// Seed of the zone keys; the same seed gives the same trust anchor
+    pub seed: u64,
+    /// TTL of every record
+    pub ttl: u32,
+}
+
+impl Default for ZoneConfig {
+    fn default() -> Self {
+        Self {
+            domains: vec!["example.com".to_string()],
+            users: 1_000_000,
+            record: DEFAULT_RECORD.to_string(),
+            records: Vec::new(),
+            seed: 0,
+            ttl: 3600,
+        }
+    }
+}
+
+/// Root key a resolver trusts, as a DS record (key tag and SHA-256 digest)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct TrustAnchor {
+    pub key_tag: u16,
+    pub digest: [u8; 32],
+}
+
+struct Zone {
+    secret: [u8; 32],
+    key_tag: u16,
+    /// DNSKEY RRset and its signature
+    dnskey: [Record; 2],
+    /// DS RRset in the parent and its signature, None for the root
+    ds: Option<[Record; 2]>,
+}
+
+/// Signed zones answering queries for a `DnsServer`
+pub(crate) struct Zones {
+    zones: HashMap<Name, Zone>,
+    /// Domain zones, whose users live under `user._bitcoin-payment`
+    domains: Vec<Name>,
+    records: HashMap<Name, String>,
+    users: u64,
+    record: String,
+    ttl: u32,
+    inception: u32,
+    expiration: u32,
+}
+
+impl Zones {
+    pub(crate) fn new(config: &ZoneConfig) -> Option<Self> {
+        let now = SystemTime::now().duration_since(UNIX_EPOCH).unwrap_or_default().as_secs() as u32;
+        let mut zones = Zones {
+            zones: HashMap::new(),
+            domains: Vec::new(),
+            records: HashMap::new(),
+            users: config.users,
+            record: config.record.clone(),
+            ttl: config.ttl,
+            inception: now.saturating_sub(3600),
+            expiration: now.saturating_add(30 * 24 * 3600),
+        };
+        
+        let mut names = vec![Name::root()];
+        for domain in &config.domains {
+            let domain = Name::parse(domain).filter(|domain| !domain.is_root())?;
+            let mut tld = domain.clone();
+            while let Some(parent) = tld.parent().filter(|parent| !parent.is_root()) {
+                tld = parent;
+            }
+            names.push(tld);
+            zones.domains.push(domain.clone());
+            names.push(domain);
+        }
+        // Parents first, so that each delegation is signed by its closest parent
+        names.sort_by_key(Name::labels);
+        zones.domains.sort_by_key(|domain| std::cmp::Reverse(domain.labels()));
+        for name in names {
+            if !zones.zones.contains_key(&name) {
+                zones.add_zone(name, config.seed);
+            }
+        }
+        
+        for (hrn, record) in &config.records {
+            let (user, domain) = hrn.split_once('@')?;
+            zones.records.insert(Name::parse(&format!("{}.user._bitcoin-payment.{}", user, domain))?, record.clone());
+        }
+        Some(zones)
+    }
+    
+    fn add_zone(&mut self, name: Name, seed: u64) {
+        let secret = digest(&[&seed.to_be_bytes(), &name.to_wire()]);
+        let rdata = dnskey_rdata(&secret);
+        let key_tag = key_tag(&rdata);
+        let dnskey = Record { name: name.clone(), rtype: TYPE_DNSKEY, ttl: self.ttl, rdata };
+        let dnskey_sig = self.sign(&secret, key_tag, &name, std::slice::from_ref(&dnskey));
+        
+        let ds = self.parent_zone(&name).map(|parent| {
+            let parent_zone = &self.zones[&parent];
+            let mut rdata = key_tag.to_be_bytes().to_vec();
+            rdata.extend_from_slice(&[ALGORITHM, DIGEST_SHA256]);
+            rdata.extend_from_slice(&digest(&[&name.to_wire(), &dnskey.rdata]));
+            let ds = Record { name: name.clone(), rtype: TYPE_DS, ttl: self.ttl, rdata };
+            let sig = self.sign(&parent_zone.secret, parent_zone.key_tag, &parent, std::slice::from_ref(&ds));
+            [ds, sig]
+        });
+        
+        self.zones.insert(name, Zone { secret, key_tag, dnskey: [dnskey, dnskey_sig], ds });
+    }
+    
+    /// The closest zone strictly above `name`
+    fn parent_zone(&self, name: &Name) -> Option<Name> {
+        let mut next = name.parent();
+        while let Some(candidate) = next {
+            if self.zones.contains_key(&candidate) {
+                return Some(candidate);
+            }
+            next = candidate.parent();
+        }
+        None
+    }
+    
+    fn sign(&self, secret: &[u8; 32], key_tag: u16, signer: &Name, rrset: &[Record]) -> Record {
+        let first = &rrset[0];
+        let mut rdata = first.rtype.to_be_bytes().to_vec();
+        rdata.extend_from_slice(&[ALGORITHM, first.name.labels()]);
+        rdata.extend_from_slice(&first.ttl.to_be_bytes());
+        rdata.extend_from_slice(&self.expiration.to_be_bytes());
+        rdata.extend_from_slice(&self.inception.to_be_bytes());
+        rdata.extend_from_slice(&key_tag.to_be_bytes());
+        signer.write(&mut rdata);
+        let signature = hmac(secret, &[&rdata, &canonical_rrset(rrset)]);
+        rdata.extend_from_slice(&signature);
+        Record { name: first.name.clone(), rtype: TYPE_RRSIG, ttl: first.ttl, rdata }
+    }
+    
+    /// Trust anchor for the root key
+    pub(crate) fn trust_anchor(&self) -> TrustAnchor {
+        let root = &self.zones[&Name::root()];
+        TrustAnchor {
+            key_tag: root.key_tag,
+            digest: digest(&[&Name::root().to_wire(), &root.dnskey[0].rdata]),
+        }
+    }
+    
+    /// Signed answer to a query, or None if the name does not exist
+    pub(crate) fn answer(&self, name: &Name, rtype: u16) -> Option<Vec<Record>> {
+        if let Some(zone) = self.zones.get(name) {
+            return Some(match rtype {
+                TYPE_DNSKEY => zone.dnskey.to_vec(),
+                TYPE_DS => zone.ds.as_ref().map_or_else(Vec::new, |ds| ds.to_vec()),
+                _ => Vec::new(),
+            });
+        }
+        
+        let domain = self.domains.iter().find(|domain| name.is_within(domain))?;
+        let text = self.user_record(name, domain)?;
+        if rtype != TYPE_TXT {
+            return Some(Vec::new());
+        }
+        let zone = &self.zones[domain];
+        let txt = Record { name: name.clone(), rtype: TYPE_TXT, ttl: self.ttl, rdata: txt_rdata(text) };
+        let sig = self.sign(&zone.secret, zone.key_tag, domain, std::slice::from_ref(&txt));
+        Some(vec![txt, sig])
+    }
+    
+    fn user_record<'a>(&'a self, name: &Name, domain: &Name) -> Option<&'a str> {
+        if let Some(record) = self.records.get(name) {
+            return Some(record);
+        }
+        // "user<n>.user._bitcoin-payment.<domain>"
+        let user = name.to_string();
+        let user = user.strip_suffix(&format!("user._bitcoin-payment.{}", domain))?.strip_suffix('.')?;
+        let n: u64 = user.strip_prefix("user")?.parse().ok()?;
+        (n < self.users && user == format!("user{}", n)).then_some(self.record.as_str())
+    }
+}
+
+fn dnskey_rdata(secret: &[u8; 32]) -> Vec<u8> {
+    let mut rdata = KEY_FLAGS.to_be_bytes().to_vec();
+    rdata.extend_from_slice(&[3, ALGORITHM]);
+    Name::parse(ALGORITHM_NAME).expect("valid algorithm name").write(&mut rdata);
+    rdata.extend_from_slice(secret);
+    rdata
+}
+
+/// HMAC key of a private-algorithm DNSKEY, None for other keys
+fn dnskey_secret(rdata: &[u8]) -> Option<&[u8]> {
+    if rdata.get(3) != Some(&ALGORITHM) {
+        return None;
+    }
+    let mut pos = 4;
+    let name = Name::read(rdata, &mut pos)?;
+    (name == Name::parse(ALGORITHM_NAME)?).then(|| &rdata[pos..])
+}
+
+/// Key tag of DNSKEY rdata (RFC 4034 Appendix B)
+pub(crate) fn key_tag(rdata: &[u8]) -> u16 {
+    let mut sum: u32 = 0;
+    for (i, byte) in rdata.iter().enumerate() {
+        sum += if i & 1 == 0 { (*byte as u32) << 8 } else { *byte as u32 };
+    }
+    sum += (sum >> 16) & 0xffff;
+    sum as u16
+}
+
+/// SHA-256 of the concatenation of `parts`
+fn digest(parts: &[&[u8]]) -> [u8; 32] {
+    let mut engine = sha256::Hash::engine();
+    for part in parts {
+        engine.input(part);
+    }
+    sha256::Hash::from_engine(engine).to_byte_array()
+}
+
+/// HMAC-SHA256 of the concatenation of `parts`
+fn hmac(key: &[u8], parts: &[&[u8]]) -> [u8; 32] {
+    let mut engine = HmacEngine::<sha256::Hash>::new(key);
+    for part in parts {
+        engine.input(part);
+    }
+    Hmac::<sha256::Hash>::from_engine(engine).to_byte_array()
+}
+
+/// RRset in canonical form and order (RFC 4034 6.3), as covered by an RRSIG
+fn canonical_rrset(rrset: &[Record]) -> Vec<u8> {
+    let mut sorted: Vec<&Record> = rrset.iter().collect();
+    sorted.sort_by(|a, b| a.rdata.cmp(&b.rdata));
+    let mut out = Vec::new();
+    for record in sorted {
+        record.write(&mut out);
+    }
+    out
+}
+
+/// Check that `sig` is a valid signature of `rrset` by one of `keys`,
+/// returning the signer's name
+pub(crate) fn verify(rrset: &[Record], sig: &Record, keys: &[Record], now: u32) -> Result<Name, &'static str> {
+    let first = rrset.first().ok_or("empty RRset")?;
+    let rdata = &sig.rdata;
+    if rdata.len() < 18 {
+        return Err("malformed RRSIG");
+    }
+    let mut pos = 18;
+    let signer = Name::read(rdata, &mut pos).ok_or("malformed RRSIG")?;
+    let field = |i: usize| u32::from_be_bytes([rdata[i], rdata[i + 1], rdata[i + 2], rdata[i + 3]]);
+    let (expiration, inception) = (field(8), field(12));
+    let tag = u16::from_be_bytes([rdata[16], rdata[17]]);
+    
+    if u16::from_be_bytes([rdata[0], rdata[1]]) != first.rtype || rdata[2] != ALGORITHM {
+        return Err("RRSIG does not cover the RRset");
+    }
+    if !first.name.is_within(&signer) {
+        return Err("RRSIG signer is not a parent of the RRset");
+    }
+    if now < inception || now > expiration {
+        return Err("RRSIG is not valid at this time");
+    }
+    
+    let expected = canonical_rrset(rrset);
+    let signed = keys.iter()
+        .filter(|key| key.name == signer && key_tag(&key.rdata) == tag)
+        .filter_map(|key| dnskey_secret(&key.rdata))
+        .any(|secret| hmac(secret, &[&rdata[..pos], &expected])[..] == rdata[pos..]);
+    if signed { Ok(signer) } else { Err("DNSSEC signature mismatch") }
+}
+
+/// Whether a DS record matches one of the zone's keys
+pub(crate) fn ds_matches(ds: &Record, keys: &[Record]) -> bool {
+    let rdata = &ds.rdata;
+    if rdata.len() != 36 || rdata[3] != DIGEST_SHA256 {
+        return false;
+    }
+    let tag = u16::from_be_bytes([rdata[0], rdata[1]]);
+    keys.iter().any(|key| {
+        key_tag(&key.rdata) == tag && digest(&[&key.name.to_wire(), &key.rdata])[..] == rdata[4..]
+    })
+}
+
+/// Whether one of the root keys matches the trust anchor
+pub(crate) fn anchor_matches(anchor: &TrustAnchor, keys: &[Record]) -> bool {
+    keys.iter().any(|key| {
+        key.name.is_root()
+            && key_tag(&key.rdata) == anchor.key_tag
+            && digest(&[&key.name.to_wire(), &key.rdata]) == anchor.digest
+    })
+}
@@ -0,0 +1,405 @@
+//! Structured tracing of resolution stages (`tracing` feature)
+//!
+//! Each resolution runs in a `resolve` span (target `bip353`) carrying the
+//! name, upstream, cache status, outcome and the time spent in each stage in
+//! microseconds. Without the feature the span helpers are empty inline
+//! functions. With it but no subscriber interested in the span, no clocks are
+//! read unless the caller asked for a `ResolutionReport`, which the same
+//! stage timers fill in.
+
+use std::future::Future;
+use std::net::SocketAddr;
+use std::pin::Pin;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+use bitcoin_payment_instructions::{
+    amount::Amount,
+    hrn_resolution::{
+        HrnResolution,
+        HrnResolutionFuture,
+        HrnResolver,
+        HumanReadableName,
+        LNURLResolutionFuture,
+    },
+};
+
+use crate::middleware::ResolveResult;
+use crate::report::ReportCollector;
+use crate::usdt;
+
+#[cfg(feature = "tracing")]
+use tracing::{field::Empty, Instrument, Span};
+
+/// Address string parsing
+#[cfg(feature = "tracing")]
+pub(crate) const PARSE: &str = "parse_us";
+/// Lookups through the HRN resolver: TCP connect, DNS exchange and DNSSEC
+/// validation for the DNS transport
+#[cfg(feature = "tracing")]
+pub(crate) const TRANSPORT: &str = "transport_us";
+/// `PaymentInstructions` parsing, excluding transport time
+#[cfg(feature = "tracing")]
+pub(crate) const INSTRUCTIONS: &str = "instructions_us";
+/// Building the BIP-21 URI
+pub(crate) const URI: &str = "uri_us";
+
+/// Run `resolution` inside a `resolve` span and record its outcome
+pub(crate) fn resolution<'a, F>(
+    hrn: &'a str,
+    upstream: Option<SocketAddr>,
+    cache_enabled: bool,
+    parse: Timer,
+    resolution: F,
+) -> impl Future<Output = ResolveResult> + 'a
+where
+    F: Future<Output = ResolveResult> + 'a,
+{
+    #[cfg(feature = "tracing")]
+    return async move {
+        let span = tracing::debug_span!(
+            target: "bip353",
+            "resolve",
+            hrn = hrn,
+            upstream = upstream.map(tracing::field::display),
+            cache = Empty,
+            outcome = Empty,
+            total_us = Empty,
+            parse_us = Empty,
+            transport_us = Empty,
+            instructions_us = Empty,
+            uri_us = Empty,
+        );
+        if span.is_disabled() {
+            return resolution.await;
+        }
+        
+        if !cache_enabled {
+            span.record("cache", "off");
+        }
+        parse.record_in(&span, PARSE);
+        
+        let start = Instant::now();
+        let result = resolution.instrument(span.clone()).await;
+        span.record("total_us", micros(start.elapsed()));
+        span.record("outcome", match &result {
+            Ok(_) => "success",
+            Err(err) => err.kind().as_str(),
+        });
+        result
+    };
+    
+    #[cfg(not(feature = "tracing"))]
+    {
+        let _ = (hrn, upstream, cache_enabled, parse);
+        resolution
+    }
+}
+
+/// Record a text field (such as the cache status) on the current span
+#[inline]
+pub(crate) fn record(field: &'static str, value: &'static str) {
+    #[cfg(feature = "tracing")]
+    if enabled() {
+        Span::current().record(field, value);
+    }
+    
+    #[cfg(not(feature = "tracing"))]
+    let _ = (field, value);
+}
+
+/// Start time of a stage, taken only while tracing or a report is enabled
+#[derive(Clone, Copy)]
+pub(crate) struct Timer {
+    start: Option<Instant>,
+}
+
+impl Timer {
+    #[inline]
+    pub(crate) fn start(report: Option<&ReportCollector>) -> Self {
+        Self {
+            start: (enabled() || report.is_some()).then(Instant::now),
+        }
+    }
+    
+    /// Record the time since `start` as `field` of the current span and as
+    /// processing time of `report`
+    #[inline]
+    pub(crate) fn record(self, field: &'static str, report: Option<&ReportCollector>) {
+        let elapsed = match self.start {
+            Some(start) => start.elapsed(),
+            None => return,
+        };
+        
+        #[cfg(feature = "tracing")]
+        Span::current().record(field, micros(elapsed));
+        #[cfg(not(feature = "tracing"))]
+        let _ = field;
+        
+        if let Some(report) = report {
+            report.processing(elapsed);
+        }
+    }
+    
+    #[cfg(feature = "tracing")]
+    fn record_in(self, span: &Span, field: &'static str) {
+        if let Some(start) = self.start {
+            span.record(field, micros(start.elapsed()));
+        }
+    }
+}
+
+/// Whether a subscriber may be interested in resolution spans
+#[inline]
+fn enabled() -> bool {
+    #[cfg(feature = "tracing")]
+    return tracing::level_enabled!(tracing::Level::DEBUG);
+    
+    #[cfg(not(feature = "tracing"))]
+    false
+}
+
+fn micros(elapsed: Duration) -> u64 {
+    elapsed.as_micros().min(u64::MAX as u128) as u64
+}
+
+/// HRN resolver wrapper that measures the lookups made through it
+///
+/// `PaymentInstructions::parse` interleaves lookups with parsing, so the
+/// transport time is summed here and subtracted from the total.
+pub(crate) struct Transport<'a, R> {
+    inner: &'a R,
+    report: Option<&'a ReportCollector>,
+    start: Option<Instant>,
+    elapsed_us: AtomicU64,
+    /// Length of the name being resolved, for USDT probes
+    hrn_len: usize,
+}
+
+impl<'a, R: HrnResolver + Sync> Transport<'a, R> {
+    #[inline]
+    pub(crate) fn new(inner: &'a R, report: Option<&'a ReportCollector>, hrn_len: usize) -> Self {
+        Self {
+            inner,
+            report,
+            start: Timer::start(report).start,
+            elapsed_us: AtomicU64::new(0),
+            hrn_len,
+        }
+    }
+    
+    /// Record the transport time and the rest of the time since creation
+    #[inline]
+    pub(crate) fn finish(&self) {
+        let start = match self.start {
+            Some(start) => start,
+            None => return,
+        };
+        let transport = Duration::from_micros(self.elapsed_us.load(Ordering::Relaxed));
+        let processing = start.elapsed().saturating_sub(transport);
+        
+        #[cfg(feature = "tracing")]
+        {
+            let span = Span::current();
+            span.record(TRANSPORT, micros(transport));
+            span.record(INSTRUCTIONS, micros(processing));
+        }
+        
+        if let Some(report) = self.report {
+            report.processing(processing);
+        }
+    }
+    
+    fn timed<'b, T: 'b>(
+        &'b self,
+        lookup: Pin<Box<dyn Future<Output = T> + Send + 'b>>,
+        bytes_received: fn(&T) -> u64,
+        failed: fn(&T) -> bool,
+    ) -> Pin<Box<dyn Future<Output = T> + Send + 'b>> {
+        let send = usdt::sdt_start!(upstream__send, self.hrn_len);
+        if self.start.is_none() && send.is_none() {
+            return lookup;
+        }
+        
+        Box::pin(async move {
+            let start = self.start.map(|_| Instant::now());
+            let result = lookup.await;
+            if let Some(start) = start {
+                let elapsed = start.elapsed();
+                self.elapsed_us.fetch_add(micros(elapsed), Ordering::Relaxed);
+                if let Some(report) = self.report {
+                    report.query(elapsed, bytes_received(&result));
+                }
+            }
+            usdt::sdt!(
+                upstream__receive,
+                self.hrn_len,
+                usdt::latency_us(send),
+                failed(&result) as u64,
+                bytes_received(&result),
+            );
+            result
+        })
+    }
+}
+
+/// Size of the proof and record text in a lookup result
+fn resolution_size(result: &Result<HrnResolution, &'static str>) -> u64 {
+    match result {
+        Ok(HrnResolution::DNSSEC { proof, result }) => {
+            (proof.as_ref().map_or(0, Vec::len) + result.len()) as u64
+        },
+        _ => 0,
+    }
+}
+
+impl<R: HrnResolver + Sync> HrnResolver for Transport<'_, R> {
+    fn resolve_hrn<'b>(&'b self, hrn: &'b HumanReadableName) -> HrnResolutionFuture<'b> {
+        self.timed(self.inner.resolve_hrn(hrn), resolution_size, Result::is_err)
+    }
+    
+    fn resolve_lnurl<'b>(&'b self, url: &'b str) -> HrnResolutionFuture<'b> {
+        self.timed(self.inner.resolve_lnurl(url), resolution_size, Result::is_err)
+    }
+    
+    fn resolve_lnurl_to_invoice<'b>(
+        &'b self,
+        callback_url: String,
+        amount: Amount,
+        expected_description_hash: [u8; 32],
+    ) -> LNURLResolutionFuture<'b> {
+        let lookup = self.inner.resolve_lnurl_to_invoice(callback_url, amount, expected_description_hash);
+        self.timed(lookup, |_| 0, Result::is_err)
+    }
+}
+
+#[cfg(all(test, feature = "tracing"))]
+mod tests {
+    use super::*;
+    use std::collections::HashMap;
+    use std::fmt;
+    use std::sync::{Arc, Mutex};
+    use tracing::field::{Field, Visit};
+    use tracing::span::{Attributes, Id, Record};
+    use tracing::{Event, Metadata, Subscriber};
+    use tracing_core::span::Current;
+    
+    use crate::{Bip353Resolver, ResolverConfig};
+    
+    /// Subscriber that keeps every field recorded on every span
+    #[derive(Clone, Default)]
+    struct Recorder {
+        spans: Arc<Mutex<Vec<(&'static Metadata<'static>, HashMap<&'static str, String>)>>>,
+        entered: Arc<Mutex<Vec<Id>>>,
+    }
+    
+    struct Fields<'a>(&'a mut HashMap<&'static str, String>);
+    
+    impl Visit for Fields<'_> {
+        fn record_debug(&mut self, field: &Field, value: &dyn fmt::Debug) {
+            self.0.insert(field.name(), format!("{:?}", value));
+        }
+        
+        fn record_str(&mut self, field: &Field, value: &str) {
+            self.0.insert(field.name(), value.to_string());
+        }
+    }
+    
+    impl Subscriber for Recorder {
+        fn enabled(&self, _metadata: &Metadata<'_>) -> bool {
+            true
+        }
+        
+        fn new_span(&self, span: &Attributes<'_>) -> Id {
+            let mut fields = HashMap::new();
+            span.record(&mut Fields(&mut fields));
+            let mut spans = self.spans.lock().unwrap();
+            spans.push((span.metadata(), fields));
+            Id::from_u64(spans.len() as u64)
+        }
+        
+        fn record(&self, span: &Id, values: &Record<'_>) {
+            let mut spans = self.spans.lock().unwrap();
+            values.record(&mut Fields(&mut spans[span.into_u64() as usize - 1].1));
+        }
+        
+        fn record_follows_from(&self, _span: &Id, _follows: &Id) {}
+        
+        fn event(&self, _event: &Event<'_>) {}
+        
+        fn enter(&self, span: &Id) {
+            self.entered.lock().unwrap().push(span.clone());
+        }
+        
+        fn exit(&self, _span: &Id) {
+            self.entered.lock().unwrap().pop();
+        }
+        
+        fn current_span(&self) -> Current {
+            match self.entered.lock().unwrap().last() {
+                Some(id) => Current::new(id.clone(), self.spans.lock().unwrap()[id.into_u64() as usize - 1].0),
+                None => Current::none(),
+            }
+        }
+    }
+    
+    /// HRN resolver that answers every name with the same on-chain address
+    struct StaticResolver;
+    
+    impl HrnResolver for StaticResolver {
+        fn resolve_hrn<'a>(&'a self, _hrn: &'a HumanReadableName) -> HrnResolutionFuture<'a> {
+            Box::pin(async {
+                Ok(HrnResolution::DNSSEC {
+                    proof: None,
+                    result: "bitcoin:bc1qar0srrr7xfkvy5l643lydnw9re59gtzzwf5mdq".to_string(),
+                })
+            })
+        }
+        
+        fn resolve_lnurl<'a>(&'a self, _url: &'a str) -> HrnResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+        
+        fn resolve_lnurl_to_invoice<'a>(&'a self, _: String, _: Amount, _: [u8; 32]) -> LNURLResolutionFuture<'a> {
+            Box::pin(async { Err("no records") })
+        }
+    }
+    
+    #[test]
+    fn test_resolve_span() {
+        let config = ResolverConfig::default().with_cache_ttl(Duration::from_secs(60));
+        let resolver = Bip353Resolver::with_hrn_resolver(StaticResolver, config);
+        let runtime = tokio::runtime::Builder::new_current_thread().enable_all().build().unwrap();
+        
+        // No subscriber has been installed yet, so no stage reads the clock
+        assert!(Timer::start(None).start.is_none());
+        assert!(Transport::new(&StaticResolver, None, 0).start.is_none());
+        
+        let recorder = Recorder::default();
+        tracing::subscriber::with_default(recorder.clone(), || {
+            assert!(Timer::start(None).start.is_some());
+            for _ in 0..2 {
+                runtime.block_on(resolver.resolve("alice", "example.com")).unwrap();
+            }
+        });
+        
+        let spans = recorder.spans.lock().unwrap();
+        let resolves: Vec<_> = spans.iter()
+            .filter(|(metadata, _)| metadata.name() == "resolve")
+            .map(|(_, fields)| fields)
+            .collect();
+        assert_eq!(resolves.len(), 2);
+        let (miss, hit) = (resolves[0], resolves[1]);
+        
+        assert_eq!(miss["cache"], "miss");
+        assert_eq!(hit["cache"], "hit");
+        for fields in [miss, hit] {
+            assert_eq!(fields["hrn"], "alice@example.com");
+            assert_eq!(fields["outcome"], "success");
+            assert!(fields["total_us"].parse::<u64>().is_ok());
+        }
+        // A hit never reaches the transport
+        assert!(miss[TRANSPORT].parse::<u64>().is_ok());
+        assert!(!hit.contains_key(TRANSPORT));
+    }
+}
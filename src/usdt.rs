@@ -0,0 +1,54 @@
+//! Static USDT probes for bpftrace, perf and SystemTap (`usdt` feature)
+//!
+//! Probes are emitted into the `.note.stapsdt` ELF section under the
+//! `bip353` provider. An unattached probe is a single `nop` behind a
+//! semaphore check; its arguments, including the clock reads behind the
+//! latency arguments, are only evaluated while a tracer is attached. Without
+//! the feature the probe macros expand to nothing.
+//!
+//! Latencies are in microseconds and measured from the matching start
+//! probe, so attach start and end probes together. Status is 0 on
+//! success and `ErrorKind as u64 + 1` on failure. See `bpftrace/` for sample
+//! scripts and the full probe list.
+
+use std::time::Instant;
+
+use crate::Bip353Error;
+
+/// Fire a probe; arguments are only evaluated while it is attached
+macro_rules! sdt {
+    ($name:ident $(, $arg:expr)* $(,)?) => {
+        #[cfg(feature = "usdt")]
+        ::probe::probe_lazy!(bip353, $name $(, $arg)*);
+        #[cfg(not(feature = "usdt"))]
+        { $( let _ = || $arg; )* }
+    };
+}
+
+/// Fire a start probe, returning the time it fired while it is attached
+macro_rules! sdt_start {
+    ($name:ident, $first:expr $(, $arg:expr)* $(,)?) => {{
+        #[allow(unused_mut, unused_assignments)]
+        let mut start: Option<::std::time::Instant> = None;
+        $crate::usdt::sdt!($name, { start = Some(::std::time::Instant::now()); $first } $(, $arg)*);
+        start
+    }};
+}
+
+pub(crate) use sdt;
+pub(crate) use sdt_start;
+
+/// Microseconds since a start probe fired, 0 if it was not attached
+#[inline]
+pub(crate) fn latency_us(start: Option<Instant>) -> u64 {
+    start.map_or(0, |start| start.elapsed().as_micros().min(u64::MAX as u128) as u64)
+}
+
+/// Probe status of a result
+#[inline]
+pub(crate) fn status<T>(result: &Result<T, Bip353Error>) -> u64 {
+    match result {
+        Ok(_) => 0,
+        Err(err) => err.kind() as u64 + 1,
+    }
+}
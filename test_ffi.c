@@ -5,30 +5,24 @@
 #include <string.h>
 #include <unistd.h>
 
-// Copy the basic FFI declarations (since we don't have the full header yet)
-typedef struct ResolverPtr ResolverPtr;
-typedef struct Bip353Result {
-    int success;
-    char* uri;
-    char* payment_type;
-    int is_reusable;
-    char* error;
-} Bip353Result;
+#include "bip353.h"
 
-// Function declarations - these should match your FFI
-extern ResolverPtr* bip353_resolver_create(void);
-extern void bip353_resolver_free(ResolverPtr* ptr);
-extern Bip353Result* bip353_resolve_address(const ResolverPtr* ptr, const char* address);
-extern void bip353_result_free(Bip353Result* ptr);
-extern int bip353_parse_address(const char* address, char** user_out, char** domain_out);
-extern void bip353_string_free(char* ptr);
+// Resolutions go to a local DNS server with signed zones, so the test runs
+// without network access. It serves user0@example.com to user9@example.com.
+static Bip353TestServer* server = NULL;
+
+static ResolverPtr* create_local_resolver(void) {
+    Bip353Config config;
+    bip353_config_init(&config);
+    return bip353_resolver_create_local(server, &config);
+}
 
 void test_basic_ffi() {
     printf("=== Testing Basic FFI Functionality ===\n\n");
     
     // Test 1: Create resolver
     printf("1. Creating resolver...\n");
-    ResolverPtr* resolver = bip353_resolver_create();
+    ResolverPtr* resolver = create_local_resolver();
     if (!resolver) {
         printf("❌ Failed to create resolver\n");
         return;
@@ -39,7 +33,7 @@ void test_basic_ffi() {
     printf("2. Testing address parsing...\n");
     char* user = NULL;
     char* domain = NULL;
-    const char* test_address = "matt@mattcorallo.com";
+    const char* test_address = "user1@example.com";
     
     if (bip353_parse_address(test_address, &user, &domain)) {
         printf("✅ Address parsed successfully:\n");
@@ -85,7 +79,7 @@ void test_basic_ffi() {
 void test_error_handling() {
     printf("\n=== Testing Error Handling ===\n\n");
     
-    ResolverPtr* resolver = bip353_resolver_create();
+    ResolverPtr* resolver = create_local_resolver();
     if (!resolver) {
         printf("❌ Failed to create resolver\n");
         return;
@@ -107,7 +101,7 @@ void test_error_handling() {
     
     // Test with non-existent domain
     printf("\n2. Testing non-existent domain...\n");
-    result = bip353_resolve_address(resolver, "test@nonexistent-domain-12345.com");
+    result = bip353_resolve_address(resolver, "user1@nonexistent-domain-12345.com");
     if (!result) {
         printf("❌ Failed to get result\n");
     } else {
@@ -125,16 +119,16 @@ void test_error_handling() {
 void test_multiple_resolutions() {
     printf("\n=== Testing Multiple Resolutions ===\n\n");
     
-    ResolverPtr* resolver = bip353_resolver_create();
+    ResolverPtr* resolver = create_local_resolver();
     if (!resolver) {
         printf("❌ Failed to create resolver\n");
         return;
     }
     
     const char* addresses[] = {
-        "matt@mattcorallo.com",
-        "test@example.com",
-        "₿demo@btcpayserver.org"
+        "user1@example.com",
+        "₿user2@example.com",
+        "user10@example.com"
     };
     
     int num_addresses = sizeof(addresses) / sizeof(addresses[0]);
@@ -165,10 +159,17 @@ int main() {
     printf("🔗 BIP-353 FFI Integration Test\n");
     printf("================================\n\n");
     
+    server = bip353_test_server_start(10, 0);
+    if (!server) {
+        printf("❌ Failed to start the local DNS server\n");
+        return 1;
+    }
+    
     test_basic_ffi();
     test_error_handling();
     test_multiple_resolutions();
     
+    bip353_test_server_free(server);
     printf("\n🎉 FFI testing completed!\n");
     printf("If you see this message, the FFI bindings are working correctly.\n");
     
@@ -0,0 +1,76 @@
+//! End-to-end resolutions against the local stand-in DNS server
+#![cfg(feature = "testing")]
+
+use bip353::testing::{DnsServer, DnsServerConfig, LocalHrnResolver, TrustAnchor, ZoneConfig, DEFAULT_RECORD};
+use bip353::{Bip353Resolver, PaymentType, ResolverConfig};
+use std::time::Duration;
+
+fn resolver(server: &DnsServer) -> Bip353Resolver<LocalHrnResolver> {
+    Bip353Resolver::with_hrn_resolver(server.resolver(), ResolverConfig::default())
+}
+
+#[tokio::test]
+async fn test_signed_resolution() {
+    let config = DnsServerConfig {
+        zones: ZoneConfig {
+            domains: vec!["example.com".into(), "pay.example.org".into()],
+            users: 5_000_000,
+            records: vec![("alice@pay.example.org".into(), DEFAULT_RECORD.into())],
+            ..ZoneConfig::default()
+        },
+        ..DnsServerConfig::default()
+    };
+    let server = DnsServer::start(config).unwrap();
+    let resolver = resolver(&server);
+    
+    let info = resolver.resolve_address("user4999999@example.com").await.unwrap();
+    assert_eq!(info.uri, DEFAULT_RECORD);
+    assert_eq!(info.payment_type, PaymentType::OnChain);
+    assert!(resolver.resolve_address("alice@pay.example.org").await.is_ok());
+    
+    // Outside the generated range, and names that only exist in another domain
+    assert!(resolver.resolve_address("user5000000@example.com").await.is_err());
+    assert!(resolver.resolve_address("alice@example.com").await.is_err());
+    assert!(resolver.resolve_address("user1@example.net").await.is_err());
+    
+    let stats = server.stats();
+    assert!(stats.udp_queries > 0);
+    assert_eq!(stats.tcp_queries, 0);
+}
+
+#[tokio::test]
+async fn test_truncated_responses_retry_over_tcp() {
+    let server = DnsServer::start(DnsServerConfig::default().with_max_udp_payload(128)).unwrap();
+    
+    resolver(&server).resolve_address("user7@example.com").await.unwrap();
+    let stats = server.stats();
+    assert!(stats.truncated > 0);
+    assert_eq!(stats.tcp_queries, stats.truncated);
+}
+
+#[tokio::test]
+async fn test_latency_and_udp_loss() {
+    let config = DnsServerConfig { seed: 7, ..DnsServerConfig::default() }
+        .with_latency(Duration::from_millis(5))
+        .with_udp_loss(0.25);
+    let server = DnsServer::start(config).unwrap();
+    let hrn_resolver = server.resolver().with_timeout(Duration::from_millis(50), 10);
+    let resolver = Bip353Resolver::with_hrn_resolver(hrn_resolver, ResolverConfig::default());
+    
+    for i in 0..10 {
+        resolver.resolve(&format!("user{}", i), "example.com").await.unwrap();
+    }
+    assert!(server.stats().dropped > 0);
+}
+
+#[tokio::test]
+async fn test_untrusted_root_is_rejected() {
+    let server = DnsServer::start(DnsServerConfig::default()).unwrap();
+    let other = TrustAnchor { key_tag: server.trust_anchor().key_tag, digest: [0; 32] };
+    let resolver = Bip353Resolver::with_hrn_resolver(
+        LocalHrnResolver::new(server.addr(), other),
+        ResolverConfig::default(),
+    );
+    
+    assert!(resolver.resolve_address("user1@example.com").await.is_err());
+}